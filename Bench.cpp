@@ -0,0 +1,250 @@
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Kernel.hpp"
+#include "Model.hpp"
+
+namespace {
+constexpr std::uint32_t f_seed{20240601};
+constexpr std::size_t f_warmUpGenerations{2};
+constexpr std::size_t f_gunSpacing{512};
+constexpr auto f_nanosecondsPerSecond{1e9};
+constexpr auto f_nameColumnWidth{24};
+constexpr auto f_isaColumnWidth{9};
+constexpr auto f_numberColumnWidth{14};
+
+const std::vector<std::string> f_rPentomino{".OO", "OO.", ".O."};
+const std::vector<std::string> f_gosperGun{
+    "........................O...........",
+    "......................O.O...........",
+    "............OO......OO............OO",
+    "...........O...O....OO............OO",
+    "OO........O.....O...OO..............",
+    "OO........O...O.OO....O.O...........",
+    "..........O.....O.......O...........",
+    "...........O...O....................",
+    "............OO......................"};
+// Ten-cell pattern that turns into a block-laying switch engine and grows
+// without bound.
+const std::vector<std::string> f_switchEngine{"......O.", "....O.OO",
+                                              "....O.O.", "....O...",
+                                              "..O.....", "O.O....."};
+
+struct Workload {
+  std::string name;
+  std::size_t width;
+  std::size_t height;
+  std::size_t generations;
+  std::size_t log2Jump;
+  bool isUnbounded;
+  std::function<void(Model &)> setUp;
+};
+
+struct Result {
+  std::string name;
+  kernel::Isa isa;
+  std::size_t threads;
+  std::size_t width;
+  std::size_t height;
+  std::size_t generations;
+  std::size_t population;
+  double seconds;
+};
+
+struct Options {
+  bool isJson{false};
+  bool isEveryIsa{false};
+  std::size_t threads{0};
+  std::string filter;
+};
+
+void insertShape(Model &model, const std::vector<std::string> &shape,
+                 std::size_t col, std::size_t row) {
+  for (std::size_t r = 0; r < shape.size(); r++) {
+    for (std::size_t c = 0; c < shape[r].size(); c++) {
+      if (shape[r][c] == 'O') {
+        model.insertCell({col + c, row + r});
+      }
+    }
+  }
+}
+
+void insertCentredShape(Model &model, const std::vector<std::string> &shape) {
+  insertShape(model, shape, (model.width() - shape.front().size()) / 2,
+              (model.height() - shape.size()) / 2);
+}
+
+void insertSoup(Model &model, double density) {
+  std::mt19937 generator{f_seed};
+  std::bernoulli_distribution isAlive{density};
+  for (std::size_t row = 0; row < model.height(); row++) {
+    for (std::size_t col = 0; col < model.width(); col++) {
+      if (isAlive(generator)) {
+        model.insertCell({col, row});
+      }
+    }
+  }
+}
+
+void insertGunArray(Model &model) {
+  for (auto row = f_gunSpacing / 2; row + f_gunSpacing / 2 <= model.height();
+       row += f_gunSpacing) {
+    for (auto col = f_gunSpacing / 2; col + f_gunSpacing / 2 <= model.width();
+         col += f_gunSpacing) {
+      insertShape(model, f_gosperGun, col, row);
+    }
+  }
+}
+
+std::vector<Workload> corpus() {
+  auto soup{[](double density) {
+    return [density](Model &model) { insertSoup(model, density); };
+  }};
+  auto centred{[](const std::vector<std::string> &shape) {
+    return [&shape](Model &model) { insertCentredShape(model, shape); };
+  }};
+  return {{"soup-10", 960, 515, 1000, 0, false, soup(.10)},
+          {"soup-35", 960, 515, 1000, 0, false, soup(.35)},
+          {"soup-50", 960, 515, 1000, 0, false, soup(.50)},
+          {"r-pentomino", 960, 515, 2000, 0, false, centred(f_rPentomino)},
+          {"gosper-gun", 960, 515, 2000, 0, false, centred(f_gosperGun)},
+          {"switch-engine", 960, 515, 4000, 0, true, centred(f_switchEngine)},
+          {"r-pentomino-jump", 960, 515, 0, 20, true, centred(f_rPentomino)},
+          {"soup-35-4096", 4096, 4096, 50, 0, false, soup(.35)},
+          {"gun-array-8192", 8192, 8192, 200, 0, false, insertGunArray}};
+}
+
+Result run(const Workload &workload, const Options &options) {
+  Model model{workload.width, workload.height};
+  if (options.threads > 0) {
+    model.setThreadCount(options.threads);
+  }
+  model.setUnbounded(workload.isUnbounded);
+  workload.setUp(model);
+  for (std::size_t i = 0; i < f_warmUpGenerations; i++) {
+    model.update();
+  }
+  auto start{std::chrono::steady_clock::now()};
+  if (workload.log2Jump > 0) {
+    model.jump(workload.log2Jump);
+  }
+  for (std::size_t i = 0; i < workload.generations; i++) {
+    model.update();
+  }
+  std::chrono::duration<double> elapsed{std::chrono::steady_clock::now() -
+                                        start};
+  auto generations{workload.generations +
+                   (workload.log2Jump > 0 ? size_t{1} << workload.log2Jump
+                                          : 0)};
+  return {workload.name,   kernel::isa(),     model.threadCount(),
+          workload.width,  workload.height,   generations,
+          model.population(), elapsed.count()};
+}
+
+double generationsPerSecond(const Result &result) {
+  return static_cast<double>(result.generations) / result.seconds;
+}
+
+double cellsPerSecond(const Result &result) {
+  return generationsPerSecond(result) *
+         static_cast<double>(result.width * result.height);
+}
+
+double nanosecondsPerCell(const Result &result) {
+  return f_nanosecondsPerSecond / cellsPerSecond(result);
+}
+
+void printTable(const std::vector<Result> &results) {
+  std::cout << std::left << std::setw(f_nameColumnWidth) << "workload"
+            << std::setw(f_isaColumnWidth) << "isa" << std::right
+            << std::setw(f_numberColumnWidth) << "generations/s"
+            << std::setw(f_numberColumnWidth) << "cells/s"
+            << std::setw(f_numberColumnWidth) << "ns/cell"
+            << std::setw(f_numberColumnWidth) << "population" << std::endl;
+  for (const auto &result : results) {
+    std::cout << std::left << std::setw(f_nameColumnWidth) << result.name
+              << std::setw(f_isaColumnWidth) << kernel::toString(result.isa)
+              << std::right << std::setw(f_numberColumnWidth)
+              << std::setprecision(4) << generationsPerSecond(result)
+              << std::setw(f_numberColumnWidth) << cellsPerSecond(result)
+              << std::setw(f_numberColumnWidth) << nanosecondsPerCell(result)
+              << std::setw(f_numberColumnWidth) << result.population
+              << std::endl;
+  }
+}
+
+void printJson(const std::vector<Result> &results) {
+  std::cout << "{\"results\": [";
+  for (std::size_t i = 0; i < results.size(); i++) {
+    const auto &result{results[i]};
+    std::cout << (i == 0 ? "\n" : ",\n") << "  {\"name\": \"" << result.name
+              << "\", \"isa\": \"" << kernel::toString(result.isa)
+              << "\", \"threads\": " << result.threads
+              << ", \"width\": " << result.width
+              << ", \"height\": " << result.height
+              << ", \"generations\": " << result.generations
+              << ", \"population\": " << result.population
+              << ", \"seconds\": " << result.seconds
+              << ", \"generationsPerSecond\": " << generationsPerSecond(result)
+              << ", \"cellsPerSecond\": " << cellsPerSecond(result)
+              << ", \"nsPerCell\": " << nanosecondsPerCell(result) << "}";
+  }
+  std::cout << "\n]}" << std::endl;
+}
+
+void printUsage(const char *program) {
+  std::cerr << "Usage: " << program
+            << " [--json] [--all-isas] [--threads N] [--filter TEXT]"
+            << std::endl;
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  Options options;
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "--json") == 0) {
+      options.isJson = true;
+    } else if (std::strcmp(argv[i], "--all-isas") == 0) {
+      options.isEveryIsa = true;
+    } else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+      options.threads = std::stoul(argv[++i]);
+    } else if (std::strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+      options.filter = argv[++i];
+    } else {
+      printUsage(argv[0]);
+      return 1;
+    }
+  }
+  std::vector<kernel::Isa> isas{kernel::isa()};
+  if (options.isEveryIsa) {
+    isas.clear();
+    for (auto isa : {kernel::Isa::Scalar, kernel::Isa::Sse2, kernel::Isa::Avx2,
+                     kernel::Isa::Avx512}) {
+      if (kernel::isSupported(isa)) {
+        isas.push_back(isa);
+      }
+    }
+  }
+  std::vector<Result> results;
+  for (auto isa : isas) {
+    kernel::setIsa(isa);
+    for (const auto &workload : corpus()) {
+      if (workload.name.find(options.filter) == std::string::npos) {
+        continue;
+      }
+      results.push_back(run(workload, options));
+    }
+  }
+  if (options.isJson) {
+    printJson(results);
+  } else {
+    printTable(results);
+  }
+  return 0;
+}
@@ -0,0 +1,237 @@
+#include "Checkpoint.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define GAME_OF_LIFE_HAS_MMAP
+#endif
+
+namespace {
+constexpr auto f_checkpointFileExtension{".ckpt"};
+constexpr std::array<char, 8> f_magic{'G', 'O', 'L', 'C', 'K', 'P', 'T', 0};
+constexpr std::uint32_t f_version{1};
+constexpr std::uint32_t f_byteOrderMark{0x01020304};
+constexpr std::uint64_t f_maxDimension{std::uint64_t{1} << 32};
+
+struct Header {
+  std::array<char, 8> magic;
+  std::uint32_t version;
+  std::uint32_t byteOrderMark;
+  std::uint64_t width;
+  std::uint64_t height;
+  std::uint64_t stride;
+  std::uint64_t generation;
+  std::uint64_t population;
+  std::uint16_t birthMask;
+  std::uint16_t survivalMask;
+  std::uint32_t reserved;
+};
+
+static_assert(sizeof(Header) == 64, "checkpoint header must stay 64 bytes");
+
+// Read-only view of a whole file, mapped where the platform allows it.
+class FileSource {
+public:
+  explicit FileSource(const std::filesystem::path &path) {
+#ifdef GAME_OF_LIFE_HAS_MMAP
+    auto handle{::open(path.c_str(), O_RDONLY)};
+    if (handle < 0) {
+      throw std::runtime_error{"cannot open " + path.string()};
+    }
+    struct stat status {};
+    if (::fstat(handle, &status) != 0) {
+      ::close(handle);
+      throw std::runtime_error{"cannot open " + path.string()};
+    }
+    m_size = static_cast<std::size_t>(status.st_size);
+    if (m_size > 0) {
+      m_data = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, handle, 0);
+    }
+    ::close(handle);
+    if (m_data == MAP_FAILED) {
+      m_data = nullptr;
+      throw std::runtime_error{"cannot map " + path.string()};
+    }
+    if (m_data != nullptr) {
+      ::posix_madvise(m_data, m_size, POSIX_MADV_SEQUENTIAL);
+    }
+#else
+    m_path = path;
+    m_stream.open(path, std::ios::binary);
+    if (!m_stream) {
+      throw std::runtime_error{"cannot open " + path.string()};
+    }
+    m_size = static_cast<std::size_t>(std::filesystem::file_size(path));
+#endif
+  }
+
+  ~FileSource() {
+#ifdef GAME_OF_LIFE_HAS_MMAP
+    if (m_data != nullptr) {
+      ::munmap(m_data, m_size);
+    }
+#endif
+  }
+
+  FileSource(const FileSource &) = delete;
+  FileSource &operator=(const FileSource &) = delete;
+
+  std::size_t size() const { return m_size; }
+
+  void read(void *destination, std::size_t offset, std::size_t bytes) {
+#ifdef GAME_OF_LIFE_HAS_MMAP
+    std::memcpy(destination, static_cast<const char *>(m_data) + offset,
+                bytes);
+#else
+    m_stream.seekg(static_cast<std::streamoff>(offset));
+    m_stream.read(static_cast<char *>(destination),
+                  static_cast<std::streamsize>(bytes));
+    if (!m_stream) {
+      throw std::runtime_error{"cannot read " + m_path.string()};
+    }
+#endif
+  }
+
+private:
+  std::size_t m_size{0};
+#ifdef GAME_OF_LIFE_HAS_MMAP
+  void *m_data{nullptr};
+#else
+  std::filesystem::path m_path;
+  std::ifstream m_stream;
+#endif
+};
+
+// The guards are never written by the kernels, so a damaged file must not be
+// allowed to put cells in them.
+void clearGuards(Grid &cells) {
+  auto *words{cells.words()};
+  std::fill_n(words, cells.stride(), 0);
+  std::fill_n(words + (cells.height() + 1) * cells.stride(), cells.stride(),
+              0);
+  auto lastWord{cells.wordsPerRow() - 1};
+  for (std::size_t row = 0; row < cells.height(); row++) {
+    auto *rowWords{cells.row(row)};
+    *(rowWords - 1) = 0;
+    rowWords[lastWord] &= cells.lastWordMask();
+    rowWords[lastWord + 1] = 0;
+  }
+}
+
+std::size_t expectedWordCount(const Header &header) {
+  auto wordsPerRow{(header.width + Grid::bitsPerWord - 1) / Grid::bitsPerWord};
+  if (header.stride != wordsPerRow + 2) {
+    throw std::runtime_error{"invalid checkpoint row stride"};
+  }
+  return static_cast<std::size_t>((header.height + 2) * header.stride);
+}
+
+// Checks a header against the size of its file, and returns the number of
+// grid words that follow it.
+std::size_t checkHeader(const Header &header, std::uintmax_t fileSize) {
+  if (header.magic != f_magic) {
+    throw std::runtime_error{"not a checkpoint file"};
+  }
+  if (header.version != f_version) {
+    throw std::runtime_error{"unsupported checkpoint version " +
+                             std::to_string(header.version)};
+  }
+  if (header.byteOrderMark != f_byteOrderMark) {
+    throw std::runtime_error{"checkpoint written on another architecture"};
+  }
+  if (header.width == 0 || header.height == 0 ||
+      header.width > f_maxDimension || header.height > f_maxDimension) {
+    throw std::runtime_error{"invalid checkpoint dimensions"};
+  }
+  auto wordCount{expectedWordCount(header)};
+  if (fileSize != sizeof(Header) + wordCount * sizeof(Grid::Word)) {
+    throw std::runtime_error{"truncated checkpoint file"};
+  }
+  return wordCount;
+}
+} // namespace
+
+namespace checkpoint {
+bool isCheckpointFile(const std::filesystem::path &path) {
+  return path.extension().string() == f_checkpointFileExtension;
+}
+
+// Writes to a temporary file first, so an interrupted save never destroys
+// the previous checkpoint.
+void save(const std::filesystem::path &path, const Model &model) {
+  const auto &cells{model.aliveCells()};
+  auto rule{model.rule()};
+  Header header{f_magic,
+                f_version,
+                f_byteOrderMark,
+                cells.width(),
+                cells.height(),
+                cells.stride(),
+                model.generation(),
+                model.population(),
+                rule.birthMask,
+                rule.survivalMask,
+                0};
+  auto temporaryPath{path};
+  temporaryPath += ".tmp";
+  {
+    std::ofstream ostrm{temporaryPath, std::ios::binary | std::ios::trunc};
+    ostrm.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    ostrm.write(reinterpret_cast<const char *>(cells.words()),
+                static_cast<std::streamsize>(cells.wordCount() *
+                                             sizeof(Grid::Word)));
+    if (!ostrm.flush()) {
+      throw std::runtime_error{"cannot write " + path.string()};
+    }
+  }
+  std::filesystem::rename(temporaryPath, path);
+}
+
+Snapshot load(const std::filesystem::path &path) {
+  FileSource source{path};
+  if (source.size() < sizeof(Header)) {
+    throw std::runtime_error{"not a checkpoint file"};
+  }
+  Header header{};
+  source.read(&header, 0, sizeof(header));
+  auto wordCount{checkHeader(header, source.size())};
+  Snapshot snapshot{Grid{static_cast<std::size_t>(header.width),
+                         static_cast<std::size_t>(header.height)},
+                    Rule{header.birthMask, header.survivalMask},
+                    static_cast<std::size_t>(header.generation),
+                    static_cast<std::size_t>(header.population)};
+  source.read(snapshot.cells.words(), sizeof(Header),
+              wordCount * sizeof(Grid::Word));
+  clearGuards(snapshot.cells);
+  return snapshot;
+}
+
+// Reads the header alone, so that listing checkpoints does not read their
+// cells.
+Summary loadSummary(const std::filesystem::path &path) {
+  std::ifstream istrm{path, std::ios::binary};
+  if (!istrm) {
+    throw std::runtime_error{"cannot open " + path.string()};
+  }
+  Header header{};
+  if (!istrm.read(reinterpret_cast<char *>(&header), sizeof(header))) {
+    throw std::runtime_error{"not a checkpoint file"};
+  }
+  checkHeader(header, std::filesystem::file_size(path));
+  return {static_cast<std::size_t>(header.width),
+          static_cast<std::size_t>(header.height),
+          Rule{header.birthMask, header.survivalMask},
+          static_cast<std::size_t>(header.generation),
+          static_cast<std::size_t>(header.population)};
+}
+} // namespace checkpoint
@@ -0,0 +1,39 @@
+#ifndef GAME_OF_LIFE_CHECKPOINT_HPP
+#define GAME_OF_LIFE_CHECKPOINT_HPP
+
+#include <cstddef>
+#include <filesystem>
+
+#include "Grid.hpp"
+#include "Model.hpp"
+#include "Rule.hpp"
+
+// Binary snapshot of a simulation: a fixed header with the dimensions, rule,
+// generation and population, followed by the grid words exactly as they sit
+// in memory. Saving is one bulk write and loading maps the file and copies it
+// back, so there is nothing to parse. Files are native-endian and meant for
+// checkpointing on the same machine, not for exchange.
+namespace checkpoint {
+struct Snapshot {
+  Grid cells;
+  Rule rule;
+  std::size_t generation;
+  std::size_t population;
+};
+
+// What the header of a checkpoint tells without reading its cells.
+struct Summary {
+  std::size_t width;
+  std::size_t height;
+  Rule rule;
+  std::size_t generation;
+  std::size_t population;
+};
+
+bool isCheckpointFile(const std::filesystem::path &path);
+void save(const std::filesystem::path &path, const Model &model);
+Snapshot load(const std::filesystem::path &path);
+Summary loadSummary(const std::filesystem::path &path);
+} // namespace checkpoint
+
+#endif
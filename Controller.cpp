@@ -1,18 +1,28 @@
 #include "Controller.hpp"
 
 #include <cwctype>
+#include <filesystem>
+#include <stdexcept>
+#include <utility>
 
+#include "Checkpoint.hpp"
+#include "Profiler.hpp"
 #include "RleHelper.hpp"
 
 namespace {
 constexpr auto f_populationGenerationRate{.05};
+constexpr auto f_jumpLog2Generations{10};
+constexpr std::size_t f_longRewindGenerations{100};
+constexpr auto f_fileExtensionSeparator{'.'};
 } // namespace
 
-Controller::Controller(View &view, Model &model)
-    : m_view{view}, m_model{model}, m_mouseReferencePosition{},
-      m_isSaveFileMenuReady{true} {}
+Controller::Controller(View &view, Simulation &simulation,
+                       PatternLoader &patternLoader)
+    : m_view{view}, m_simulation{simulation}, m_patternLoader{patternLoader},
+      m_mouseReferencePosition{}, m_isSaveFileMenuReady{true} {}
 
 void Controller::onEvent(const sf::Event &event) {
+  PROFILE_SCOPE(Profiler::Stage::Events);
   switch (event.type) {
   default:
     return;
@@ -37,6 +47,30 @@ void Controller::onEvent(const sf::Event &event) {
   }
 }
 
+// Swaps a pattern into the model once its background load has finished.
+void Controller::update() {
+  auto loaded{m_patternLoader.take()};
+  if (!loaded) {
+    return;
+  }
+  m_simulation.post([loaded = std::move(loaded.value())](Model &model) mutable {
+    if (loaded.generation) {
+      model.restore(std::move(loaded.pattern.cells),
+                    loaded.rule.value_or(model.rule()),
+                    loaded.generation.value());
+      return;
+    }
+    // The rule goes first, so that one the model refuses leaves the board
+    // as it was.
+    if (loaded.rule) {
+      model.setRule(loaded.rule.value());
+    }
+    model.clear();
+    model.insertPattern(std::move(loaded.pattern));
+  });
+  m_view.setScreen(View::Screen::Main);
+}
+
 void Controller::onMouseButtonPressedInMainScreen(
     const sf::Event::MouseButtonEvent &event) {
   if (event.button != sf::Mouse::Button::Left) {
@@ -68,25 +102,27 @@ void Controller::onMouseButtonPressedInMainScreen(
     m_view.zoomIn();
     return;
   case View::Button::SpeedUp:
-    m_model.speedUp();
+    m_simulation.post(&Model::speedUp);
     return;
   case View::Button::SlowDown:
-    m_model.slowDown();
+    m_simulation.post(&Model::slowDown);
     return;
   case View::Button::Run:
-    m_model.run();
+    m_simulation.post(&Model::run);
     return;
   case View::Button::Pause:
-    m_model.pause();
+    m_simulation.post(&Model::pause);
     return;
   case View::Button::GeneratePopulation:
-    m_model.generatePopulation(f_populationGenerationRate);
+    m_simulation.post([](Model &model) {
+      model.generatePopulation(f_populationGenerationRate);
+    });
     return;
   case View::Button::Reset:
-    m_model.reset();
+    m_simulation.post(&Model::reset);
     return;
   case View::Button::Clear:
-    m_model.clear();
+    m_simulation.post(&Model::clear);
     return;
   case View::Button::EditRule:
     m_view.setScreen(View::Screen::EditRule);
@@ -102,18 +138,17 @@ void Controller::onMouseButtonPressedInLoadFileScreen(
     return;
   }
   auto highlightedLoadFileMenuItem{m_view.highlightedLoadFileMenuItem()};
-  if (highlightedLoadFileMenuItem) {
-    m_model.clear();
-    m_model.insertPattern(
-        rle::loadPattern(highlightedLoadFileMenuItem.value()));
-    m_view.setScreen(View::Screen::Main);
+  if (highlightedLoadFileMenuItem &&
+      m_patternLoader.status() == PatternLoader::Status::Idle) {
+    m_patternLoader.load(highlightedLoadFileMenuItem.value(),
+                         m_simulation.frame().isUnbounded);
     return;
   }
   auto highlightedButton{m_view.highlightedButton()};
   if (highlightedButton != View::Button::None) {
     switch (highlightedButton) {
     case View::Button::Back:
-      m_view.setScreen(View::Screen::Main);
+      onBackInLoadFileScreen();
       return;
     default:
       return;
@@ -138,7 +173,7 @@ void Controller::onMouseButtonPressedInSaveFileScreen(
     if (m_view.fileNameToSave().empty()) {
       return;
     }
-    rle::savePattern(m_view.fileNameToSave(), m_model.initialPattern());
+    saveFile();
     m_view.setScreen(View::Screen::Main);
     return;
   default:
@@ -234,7 +269,7 @@ void Controller::onTextEnteredEvent(const sf::Event::TextEvent &event) {
       return;
     }
     auto character{static_cast<char>(event.unicode)};
-    if (!std::isalpha(character) && !std::isalnum(character)) {
+    if (!std::isalnum(character) && character != f_fileExtensionSeparator) {
       return;
     }
     auto name{m_view.fileNameToSave()};
@@ -249,13 +284,17 @@ void Controller::onTextEnteredEvent(const sf::Event::TextEvent &event) {
     }
     auto value{static_cast<size_t>(std::stoi(&character))};
     if (m_view.highlightedEdit() == View::Edit::BirthRule) {
-      auto rule{m_model.birthRule()};
-      rule.insert(value);
-      m_model.setBirthRule(rule);
+      m_simulation.post([value](Model &model) {
+        auto rule{model.birthRule()};
+        rule.insert(value);
+        model.setBirthRule(rule);
+      });
     } else if (m_view.highlightedEdit() == View::Edit::SurvivalRule) {
-      auto rule{m_model.survivalRule()};
-      rule.insert(value);
-      m_model.setSurvivalRule(rule);
+      m_simulation.post([value](Model &model) {
+        auto rule{model.survivalRule()};
+        rule.insert(value);
+        model.setSurvivalRule(rule);
+      });
     }
     return;
   }
@@ -286,48 +325,93 @@ void Controller::onKeyPressed(const sf::Event::KeyEvent &event) {
 void Controller::onKeyPressedInMainScreen(const sf::Event::KeyEvent &event) {
   switch (event.code) {
   case sf::Keyboard::R:
-    if (m_model.status() != Model::Status::Running &&
-        m_model.status() != Model::Status::Paused) {
-      return;
-    }
-    m_model.reset();
+    m_simulation.post([](Model &model) {
+      if (model.status() == Model::Status::Running ||
+          model.status() == Model::Status::Paused) {
+        model.reset();
+      }
+    });
     return;
   case sf::Keyboard::L:
     m_view.setScreen(View::Screen::LoadFile);
     return;
   case sf::Keyboard::S:
-    if (m_model.initialPattern().empty()) {
+    if (!m_simulation.frame().hasInitialPattern) {
       return;
     }
     m_isSaveFileMenuReady = false;
     m_view.setScreen(View::Screen::SaveFile);
     return;
   case sf::Keyboard::G:
-    if (m_model.status() == Model::Status::ReadyToRun ||
-        m_model.status() == Model::Status::Stopped) {
-      m_model.generatePopulation(f_populationGenerationRate);
-    }
+    m_simulation.post([](Model &model) {
+      if (model.status() == Model::Status::ReadyToRun ||
+          model.status() == Model::Status::Stopped) {
+        model.generatePopulation(f_populationGenerationRate);
+      }
+    });
     return;
   case sf::Keyboard::C:
-    if (m_model.status() != Model::Status::Running) {
-      m_model.clear();
-    }
+    m_simulation.post([](Model &model) {
+      if (model.status() != Model::Status::Running) {
+        model.clear();
+      }
+    });
+    return;
+  case sf::Keyboard::J:
+    m_simulation.post([](Model &model) {
+      if (model.status() == Model::Status::ReadyToRun ||
+          model.status() == Model::Status::Paused) {
+        if (!model.jump(f_jumpLog2Generations)) {
+          for (auto generation = 0; generation < 1 << f_jumpLog2Generations;
+               generation++) {
+            model.update();
+          }
+        }
+      }
+    });
+    return;
+  case sf::Keyboard::B: {
+    auto generations{event.shift ? f_longRewindGenerations : 1};
+    m_simulation.post([generations](Model &model) {
+      if (model.status() != Model::Status::Running) {
+        model.rewind(generations);
+      }
+    });
+    return;
+  }
+  case sf::Keyboard::T:
+    m_simulation.setTurbo(!m_simulation.frame().isTurbo);
+    return;
+#ifdef GAME_OF_LIFE_PROFILER
+  case sf::Keyboard::P:
+    Profiler::instance().setEnabled(!Profiler::instance().isEnabled());
+    return;
+#endif
+  case sf::Keyboard::U:
+    m_simulation.post([](Model &model) {
+      if (model.status() != Model::Status::Running) {
+        model.setUnbounded(!model.isUnbounded());
+      }
+    });
     return;
   case sf::Keyboard::Escape:
     m_view.closeWindow();
     return;
   case sf::Keyboard::Space:
-    switch (m_model.status()) {
-    case Model::Status::ReadyToRun:
-    case Model::Status::Paused:
-      m_model.run();
-      return;
-    case Model::Status::Running:
-      m_model.pause();
-      return;
-    default:
-      return;
-    }
+    m_simulation.post([](Model &model) {
+      switch (model.status()) {
+      case Model::Status::ReadyToRun:
+      case Model::Status::Paused:
+        model.run();
+        return;
+      case Model::Status::Running:
+        model.pause();
+        return;
+      default:
+        return;
+      }
+    });
+    return;
   default:
     return;
   }
@@ -337,7 +421,7 @@ void Controller::onKeyPressedInLoadFileScreen(
     const sf::Event::KeyEvent &event) {
   switch (event.code) {
   case sf::Keyboard::Escape:
-    m_view.setScreen(View::Screen::Main);
+    onBackInLoadFileScreen();
     return;
   case sf::Keyboard::PageUp:
     m_view.pageUp();
@@ -351,6 +435,15 @@ void Controller::onKeyPressedInLoadFileScreen(
   return;
 }
 
+// Cancels a load in progress or dismisses its error before leaving the screen.
+void Controller::onBackInLoadFileScreen() {
+  if (m_patternLoader.status() != PatternLoader::Status::Idle) {
+    m_patternLoader.cancel();
+    return;
+  }
+  m_view.setScreen(View::Screen::Main);
+}
+
 void Controller::onKeyPressedInSaveFileScreen(
     const sf::Event::KeyEvent &event) {
   switch (event.code) {
@@ -361,7 +454,7 @@ void Controller::onKeyPressedInSaveFileScreen(
     if (m_view.fileNameToSave().empty()) {
       return;
     }
-    rle::savePattern(m_view.fileNameToSave(), m_model.initialPattern());
+    saveFile();
     m_view.setScreen(View::Screen::Main);
     return;
   case sf::Keyboard::Space: {
@@ -416,13 +509,9 @@ void Controller::onKeyPressedInEditRuleScreen(
     return;
   case sf::Keyboard::BackSpace: {
     if (m_view.highlightedEdit() == View::Edit::BirthRule) {
-      auto rule{m_model.birthRule()};
-      rule.clear();
-      m_model.setBirthRule(rule);
+      m_simulation.post([](Model &model) { model.setBirthRule({}); });
     } else if (m_view.highlightedEdit() == View::Edit::SurvivalRule) {
-      auto rule{m_model.survivalRule()};
-      rule.clear();
-      m_model.setSurvivalRule(rule);
+      m_simulation.post([](Model &model) { model.setSurvivalRule({}); });
     }
     return;
   }
@@ -431,15 +520,36 @@ void Controller::onKeyPressedInEditRuleScreen(
   }
 }
 
+// The cell is looked up again when the command runs, as the frame it was
+// picked from may already be out of date.
 void Controller::onMouseButtonPressedOnCell(const Cell &cell) {
-  if (m_model.status() != Model::Status::Stopped &&
-      m_model.status() != Model::Status::ReadyToRun) {
-    return;
-  }
-  if (cell.status == Cell::Status::Alive) {
-    m_model.removeCell(cell);
-  } else {
-    m_model.insertCell(cell);
-  }
-  return;
+  m_simulation.post([cell](Model &model) {
+    if (model.status() != Model::Status::Stopped &&
+        model.status() != Model::Status::ReadyToRun) {
+      return;
+    }
+    if (model.cellAt(cell.col, cell.row)->status == Cell::Status::Alive) {
+      model.removeCell(cell);
+    } else {
+      model.insertCell(cell);
+    }
+  });
+}
+
+// Checkpoints keep the current generation; every other format stores the
+// initial pattern. Either is written on the simulation thread, between two
+// generations.
+void Controller::saveFile() {
+  m_simulation.post([name = m_view.fileNameToSave()](Model &model) {
+    try {
+      if (checkpoint::isCheckpointFile(name)) {
+        std::filesystem::create_directories(rle::patternsFolder());
+        checkpoint::save(rle::patternPath(name), model);
+        return;
+      }
+      rle::savePattern(name, model.initialPattern(), model.rule());
+    } catch (const std::exception &error) {
+      throw std::runtime_error{"Cannot save " + name + ": " + error.what()};
+    }
+  });
 }
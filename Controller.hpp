@@ -4,14 +4,16 @@
 #include <SFML/System/Vector2.hpp>
 #include <SFML/Window/Event.hpp>
 
-#include "Model.hpp"
+#include "PatternLoader.hpp"
+#include "Simulation.hpp"
 #include "View.hpp"
 
 class Controller {
  public:
-  Controller(View &view, Model &model);
+  Controller(View &view, Simulation &simulation, PatternLoader &patternLoader);
 
   void onEvent(const sf::Event &event);
+  void update();
 
  private:
   void onMouseButtonPressed(const sf::Event::MouseButtonEvent &event);
@@ -33,12 +35,15 @@ class Controller {
   void onTextEnteredEvent(const sf::Event::TextEvent &event);
   void onKeyPressedInMainScreen(const sf::Event::KeyEvent &event);
   void onKeyPressedInLoadFileScreen(const sf::Event::KeyEvent &event);
+  void onBackInLoadFileScreen();
   void onKeyPressedInSaveFileScreen(const sf::Event::KeyEvent &event);
   void onKeyPressedInEditRuleScreen(const sf::Event::KeyEvent &event);
   void onMouseButtonPressedOnCell(const Cell &cell);
+  void saveFile();
 
   View &m_view;
-  Model &m_model;
+  Simulation &m_simulation;
+  PatternLoader &m_patternLoader;
   sf::Vector2i m_mouseReferencePosition;
   bool m_isSaveFileMenuReady;
 };
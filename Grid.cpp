@@ -0,0 +1,83 @@
+#include "Grid.hpp"
+
+#include <algorithm>
+#include <bitset>
+#include <numeric>
+
+namespace {
+constexpr std::size_t f_guardWords{2};
+constexpr std::size_t f_guardRows{2};
+
+inline auto toWordCount(std::size_t width) {
+  return (width + Grid::bitsPerWord - 1) / Grid::bitsPerWord;
+}
+} // namespace
+
+Grid::Grid(std::size_t width, std::size_t height)
+    : m_width{width}, m_height{height}, m_wordsPerRow{toWordCount(width)},
+      m_stride{m_wordsPerRow + f_guardWords},
+      m_words((m_height + f_guardRows) * m_stride, 0) {}
+
+std::size_t Grid::width() const { return m_width; }
+
+std::size_t Grid::height() const { return m_height; }
+
+std::size_t Grid::wordsPerRow() const { return m_wordsPerRow; }
+
+std::size_t Grid::stride() const { return m_stride; }
+
+std::size_t Grid::population() const {
+  return std::accumulate(m_words.cbegin(), m_words.cend(), std::size_t{0},
+                         [](auto sum, auto word) {
+                           return sum + std::bitset<bitsPerWord>{word}.count();
+                         });
+}
+
+bool Grid::empty() const {
+  return std::none_of(m_words.cbegin(), m_words.cend(),
+                      [](auto word) { return word != 0; });
+}
+
+std::uint64_t Grid::hash() const {
+  std::uint64_t hash{0};
+  for (std::size_t row = 0; row < m_height; row++) {
+    const auto *words{this->row(row)};
+    for (std::size_t index = 0; index < m_wordsPerRow; index++) {
+      hash ^= hashWord(row * m_wordsPerRow + index, words[index]);
+    }
+  }
+  return hash;
+}
+
+std::size_t Grid::memoryUsage() const { return m_words.size() * sizeof(Word); }
+
+Grid::Word Grid::lastWordMask() const {
+  auto usedBits{m_width % bitsPerWord};
+  return usedBits == 0 ? ~Word{0} : (Word{1} << usedBits) - 1;
+}
+
+bool Grid::at(std::size_t col, std::size_t row) const {
+  return (this->row(row)[col / bitsPerWord] >> (col % bitsPerWord)) & 1;
+}
+
+const Grid::Word *Grid::row(std::size_t row) const {
+  return m_words.data() + (row + 1) * m_stride + 1;
+}
+
+Grid::Word *Grid::row(std::size_t row) {
+  return m_words.data() + (row + 1) * m_stride + 1;
+}
+
+const Grid::Word *Grid::words() const { return m_words.data(); }
+
+Grid::Word *Grid::words() { return m_words.data(); }
+
+std::size_t Grid::wordCount() const { return m_words.size(); }
+
+void Grid::set(std::size_t col, std::size_t row, bool alive) {
+  auto &word{this->row(row)[col / bitsPerWord]};
+  auto bit{Word{1} << (col % bitsPerWord)};
+  word = alive ? (word | bit) : (word & ~bit);
+}
+
+void Grid::clear() { std::fill(m_words.begin(), m_words.end(), 0); }
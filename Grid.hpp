@@ -0,0 +1,58 @@
+#ifndef GAME_OF_LIFE_GRID_HPP
+#define GAME_OF_LIFE_GRID_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Bit-packed cell plane: one bit per cell, 64 cells per word. Every row is
+// surrounded by a zero guard word on each side, and the plane by a zero guard
+// row above and below, so kernels can read the full 3x3 neighbourhood of any
+// word without bounds checks.
+class Grid {
+public:
+  using Word = std::uint64_t;
+
+  static constexpr std::size_t bitsPerWord{64};
+
+  // Mixes a word with its index in row-major order over the cells. The hash
+  // of a grid is the XOR of those of its words, so a step can update it from
+  // the words that changed alone. The high half is folded down before the
+  // multiply, which only carries bits upwards.
+  static constexpr std::uint64_t hashWord(std::size_t index, Word word) {
+    auto hash{word ^ (index * 0x9e3779b97f4a7c15)};
+    hash = (hash ^ (hash >> 32)) * 0xbf58476d1ce4e5b9;
+    return hash ^ (hash >> 29);
+  }
+
+  Grid(std::size_t width, std::size_t height);
+
+  std::size_t width() const;
+  std::size_t height() const;
+  std::size_t wordsPerRow() const;
+  std::size_t stride() const;
+  std::size_t population() const;
+  bool empty() const;
+  std::uint64_t hash() const;
+  std::size_t memoryUsage() const;
+  Word lastWordMask() const;
+  bool at(std::size_t col, std::size_t row) const;
+  const Word *row(std::size_t row) const;
+  Word *row(std::size_t row);
+  // Whole plane including guards, for bulk copies.
+  const Word *words() const;
+  Word *words();
+  std::size_t wordCount() const;
+
+  void set(std::size_t col, std::size_t row, bool alive);
+  void clear();
+
+private:
+  std::size_t m_width;
+  std::size_t m_height;
+  std::size_t m_wordsPerRow;
+  std::size_t m_stride;
+  std::vector<Word> m_words;
+};
+
+#endif
@@ -0,0 +1,526 @@
+#include "HashLife.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
+
+namespace {
+constexpr std::uint32_t f_noNode{0xffffffff};
+constexpr std::uint32_t f_deadCell{0};
+constexpr std::uint32_t f_aliveCell{1};
+constexpr std::uint8_t f_noStep{0xff};
+constexpr std::uint8_t f_freeLevel{0xff};
+constexpr std::size_t f_minLevel{3};
+constexpr std::size_t f_minBucketCount{std::size_t{1} << 16};
+constexpr std::size_t f_defaultMemoryLimit{std::size_t{256} << 20};
+constexpr std::size_t f_emptyCheckLevel{6};
+constexpr std::size_t f_leafSize{4};
+constexpr std::size_t f_chunkLevel{6};
+constexpr std::uint64_t f_hashMultiplier{0x9e3779b97f4a7c15};
+
+struct MemoryLimitReached {};
+
+inline std::size_t hashOf(std::uint32_t nw, std::uint32_t ne, std::uint32_t sw,
+                          std::uint32_t se) {
+  auto hash{std::uint64_t{nw}};
+  hash = hash * f_hashMultiplier + ne;
+  hash = hash * f_hashMultiplier + sw;
+  hash = hash * f_hashMultiplier + se;
+  return static_cast<std::size_t>(hash ^ (hash >> 29));
+}
+
+bool isEmptyRegion(const Grid &cells, std::size_t col, std::size_t row,
+                   std::size_t size) {
+  auto firstWord{col / Grid::bitsPerWord};
+  auto lastWord{std::min(cells.wordsPerRow(),
+                         (col + size) / Grid::bitsPerWord)};
+  auto lastRow{std::min(cells.height(), row + size)};
+  for (auto r = row; r < lastRow; r++) {
+    const auto *words{cells.row(r)};
+    for (auto word = firstWord; word < lastWord; word++) {
+      if (words[word] != 0) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+} // namespace
+
+HashLife::HashLife()
+    : m_nodes{}, m_buckets(f_minBucketCount, f_noNode), m_emptyNodes{},
+      m_freeNodes{f_noNode}, m_freeNodeCount{0},
+      m_memoryLimit{f_defaultMemoryLimit}, m_isMemoryLimited{false},
+      m_rule{}, m_root{}, m_originCol{0},
+      m_originRow{0} {
+  m_nodes.push_back({f_noNode, f_noNode, f_noNode, f_noNode, f_noNode,
+                     f_noNode, 0, 0, f_noStep, false});
+  m_nodes.push_back({f_noNode, f_noNode, f_noNode, f_noNode, f_noNode,
+                     f_noNode, 1, 0, f_noStep, false});
+  m_emptyNodes.push_back(f_deadCell);
+  m_root = emptyNode(f_minLevel);
+}
+
+std::size_t HashLife::nodeCount() const {
+  return m_nodes.size() - m_freeNodeCount;
+}
+
+std::size_t HashLife::memoryUsage() const {
+  return nodeCount() * sizeof(Node) + m_buckets.size() * sizeof(NodeId);
+}
+
+std::size_t HashLife::memoryLimit() const { return m_memoryLimit; }
+
+std::uint64_t HashLife::population() const {
+  return m_nodes[m_root].population;
+}
+
+// Works out the bounds of every distinct node once, so the cost follows the
+// number of nodes rather than the area they cover.
+std::optional<HashLife::Bounds> HashLife::bounds() const {
+  std::unordered_map<NodeId, Bounds> nodeBounds;
+  std::function<Bounds(NodeId)> boundsOf{[&](NodeId id) {
+    if (id == f_aliveCell) {
+      return Bounds{0, 0, 0, 0};
+    }
+    auto found{nodeBounds.find(id)};
+    if (found != nodeBounds.end()) {
+      return found->second;
+    }
+    const auto &node{m_nodes[id]};
+    auto half{std::int64_t{1} << (node.level - 1)};
+    Bounds result{2 * half, 2 * half, -1, -1};
+    std::int64_t offsets[4][2]{{0, 0}, {half, 0}, {0, half}, {half, half}};
+    NodeId children[4]{node.nw, node.ne, node.sw, node.se};
+    for (std::size_t i = 0; i < 4; i++) {
+      if (m_nodes[children[i]].population == 0) {
+        continue;
+      }
+      auto child{boundsOf(children[i])};
+      result.left = std::min(result.left, child.left + offsets[i][0]);
+      result.top = std::min(result.top, child.top + offsets[i][1]);
+      result.right = std::max(result.right, child.right + offsets[i][0]);
+      result.bottom = std::max(result.bottom, child.bottom + offsets[i][1]);
+    }
+    nodeBounds.emplace(id, result);
+    return result;
+  }};
+  if (m_nodes[m_root].population == 0) {
+    return {};
+  }
+  auto result{boundsOf(m_root)};
+  return Bounds{result.left + m_originCol, result.top + m_originRow,
+                result.right + m_originCol, result.bottom + m_originRow};
+}
+
+HashLife::NodeId HashLife::root() const { return m_root; }
+
+HashLife::NodeId HashLife::cell(bool isAlive) const {
+  return isAlive ? f_aliveCell : f_deadCell;
+}
+
+std::size_t HashLife::level(NodeId id) const { return m_nodes[id].level; }
+
+std::uint64_t HashLife::population(NodeId id) const {
+  return m_nodes[id].population;
+}
+
+HashLife::Quadrants HashLife::quadrants(NodeId id) const {
+  const auto &node{m_nodes[id]};
+  return {node.nw, node.ne, node.sw, node.se};
+}
+
+// Places a node built with join() as the whole plane, with its top-left
+// corner at (col, row). Nodes smaller than the engine's minimum are padded.
+void HashLife::setRoot(NodeId id, std::int64_t col, std::int64_t row) {
+  m_root = id;
+  m_originCol = col;
+  m_originRow = row;
+  while (m_nodes[m_root].level < f_minLevel) {
+    auto empty{emptyNode(m_nodes[m_root].level)};
+    m_root = join(m_root, empty, empty, empty);
+  }
+}
+
+void HashLife::setMemoryLimit(std::size_t bytes) { m_memoryLimit = bytes; }
+
+void HashLife::setRule(Rule rule) {
+  if (rule == m_rule) {
+    return;
+  }
+  m_rule = rule;
+  for (auto &node : m_nodes) {
+    node.result = f_noNode;
+    node.resultStep = f_noStep;
+  }
+}
+
+void HashLife::load(const Grid &cells) {
+  auto level{f_minLevel};
+  while ((std::size_t{1} << level) < std::max(cells.width(), cells.height())) {
+    level++;
+  }
+  m_root = build(cells, level, 0, 0);
+  m_originCol = 0;
+  m_originRow = 0;
+}
+
+void HashLife::store(Grid &cells, std::int64_t col, std::int64_t row) const {
+  store(cells, m_root, m_originCol + col, m_originRow + row);
+}
+
+// Every chunk of the sparse plane becomes a node of the chunk's size, and the
+// nodes are then assembled bottom up inside the smallest square covering them.
+void HashLife::load(const SparseLife &cells) {
+  static_assert(SparseLife::chunkSize == std::size_t{1} << f_chunkLevel,
+                "chunks map onto nodes of a single level");
+  Grid chunkCells{SparseLife::chunkSize, SparseLife::chunkSize};
+  std::vector<Chunk> chunks;
+  cells.forEachChunk([&](auto col, auto row, const auto *words) {
+    for (std::size_t r = 0; r < SparseLife::chunkSize; r++) {
+      chunkCells.row(r)[0] = words[r];
+    }
+    chunks.push_back({col, row, build(chunkCells, f_chunkLevel, 0, 0)});
+  });
+  m_originCol = 0;
+  m_originRow = 0;
+  if (chunks.empty()) {
+    m_root = emptyNode(f_minLevel);
+    return;
+  }
+  auto [left, right]{std::minmax_element(
+      chunks.cbegin(), chunks.cend(),
+      [](const auto &a, const auto &b) { return a.col < b.col; })};
+  auto [top, bottom]{std::minmax_element(
+      chunks.cbegin(), chunks.cend(),
+      [](const auto &a, const auto &b) { return a.row < b.row; })};
+  auto span{std::max(right->col - left->col, bottom->row - top->row) +
+            static_cast<std::int64_t>(SparseLife::chunkSize)};
+  auto level{f_chunkLevel};
+  while ((std::int64_t{1} << level) < span) {
+    level++;
+  }
+  m_originCol = left->col;
+  m_originRow = top->row;
+  m_root = build(chunks.begin(), chunks.end(), level, m_originCol,
+                 m_originRow);
+}
+
+void HashLife::store(SparseLife &cells, std::int64_t col,
+                     std::int64_t row) const {
+  store(cells, m_root, m_originCol + col, m_originRow + row);
+}
+
+void HashLife::advance(std::size_t log2Generations) {
+  auto step{std::min(log2Generations, maxLog2Generations)};
+  if (memoryUsage() > m_memoryLimit / 2) {
+    collectGarbage(true);
+  }
+  if (memoryUsage() > m_memoryLimit / 2) {
+    collectGarbage(false);
+  }
+  while (m_nodes[m_root].level < step + f_minLevel ||
+         m_nodes[centre(centre(m_root))].population !=
+             m_nodes[m_root].population) {
+    expand();
+  }
+  try {
+    m_isMemoryLimited = step > 0;
+    auto result{successor(m_root, step)};
+    m_isMemoryLimited = false;
+    auto offset{std::int64_t{1} << (m_nodes[m_root].level - 2)};
+    m_originCol += offset;
+    m_originRow += offset;
+    m_root = result;
+  } catch (const MemoryLimitReached &) {
+    m_isMemoryLimited = false;
+    collectGarbage(false);
+    advance(step - 1);
+    advance(step - 1);
+  }
+}
+
+void HashLife::collectGarbage(bool keepResults) {
+  for (auto &node : m_nodes) {
+    node.isMarked = false;
+  }
+  m_nodes[f_deadCell].isMarked = true;
+  m_nodes[f_aliveCell].isMarked = true;
+  mark(m_root, keepResults);
+  for (auto id : m_emptyNodes) {
+    mark(id, false);
+  }
+  m_freeNodes = f_noNode;
+  m_freeNodeCount = 0;
+  for (auto id = static_cast<NodeId>(m_nodes.size()); id-- > f_aliveCell + 1;) {
+    auto &node{m_nodes[id]};
+    if (!node.isMarked) {
+      node.level = f_freeLevel;
+      node.next = m_freeNodes;
+      m_freeNodes = id;
+      m_freeNodeCount++;
+    } else if (node.result != f_noNode && !m_nodes[node.result].isMarked) {
+      node.result = f_noNode;
+      node.resultStep = f_noStep;
+    }
+  }
+  rehash(m_buckets.size());
+}
+
+HashLife::NodeId HashLife::join(NodeId nw, NodeId ne, NodeId sw, NodeId se) {
+  auto hash{hashOf(nw, ne, sw, se)};
+  auto &bucket{m_buckets[hash & (m_buckets.size() - 1)]};
+  for (auto id = bucket; id != f_noNode; id = m_nodes[id].next) {
+    const auto &node{m_nodes[id]};
+    if (node.nw == nw && node.ne == ne && node.sw == sw && node.se == se) {
+      return id;
+    }
+  }
+  if (m_isMemoryLimited && memoryUsage() > m_memoryLimit) {
+    throw MemoryLimitReached{};
+  }
+  Node node{nw,
+            ne,
+            sw,
+            se,
+            f_noNode,
+            bucket,
+            m_nodes[nw].population + m_nodes[ne].population +
+                m_nodes[sw].population + m_nodes[se].population,
+            static_cast<std::uint8_t>(m_nodes[nw].level + 1),
+            f_noStep,
+            false};
+  NodeId id{m_freeNodes};
+  if (id != f_noNode) {
+    m_freeNodes = m_nodes[id].next;
+    m_freeNodeCount--;
+    m_nodes[id] = node;
+  } else {
+    id = static_cast<NodeId>(m_nodes.size());
+    m_nodes.push_back(node);
+  }
+  bucket = id;
+  if (nodeCount() > m_buckets.size()) {
+    rehash(m_buckets.size() * 2);
+  }
+  return id;
+}
+
+HashLife::NodeId HashLife::emptyNode(std::size_t level) {
+  while (m_emptyNodes.size() <= level) {
+    auto empty{m_emptyNodes.back()};
+    m_emptyNodes.push_back(join(empty, empty, empty, empty));
+  }
+  return m_emptyNodes[level];
+}
+
+HashLife::NodeId HashLife::centre(NodeId id) {
+  auto node{m_nodes[id]};
+  return join(m_nodes[node.nw].se, m_nodes[node.ne].sw, m_nodes[node.sw].ne,
+              m_nodes[node.se].nw);
+}
+
+// Returns the centre of a node advanced by 2^step generations, where step can
+// be at most level - 2. Nodes whose step is exactly level - 2 advance both
+// halves of the way recursively; larger nodes only advance the second half.
+HashLife::NodeId HashLife::successor(NodeId id, std::size_t step) {
+  auto node{m_nodes[id]};
+  if (node.resultStep == step) {
+    return node.result;
+  }
+  if (node.population == 0) {
+    return emptyNode(node.level - 1U);
+  }
+  if (node.level == 2) {
+    auto result{evolveLeaf(id)};
+    m_nodes[id].result = result;
+    m_nodes[id].resultStep = 0;
+    return result;
+  }
+  auto nw{m_nodes[node.nw]};
+  auto ne{m_nodes[node.ne]};
+  auto sw{m_nodes[node.sw]};
+  auto se{m_nodes[node.se]};
+  NodeId parts[9]{node.nw,
+                  join(nw.ne, ne.nw, nw.se, ne.sw),
+                  node.ne,
+                  join(nw.sw, nw.se, sw.nw, sw.ne),
+                  join(nw.se, ne.sw, sw.ne, se.nw),
+                  join(ne.sw, ne.se, se.nw, se.ne),
+                  node.sw,
+                  join(sw.ne, se.nw, sw.se, se.sw),
+                  node.se};
+  auto isFullStep{step + 2 == node.level};
+  for (auto &part : parts) {
+    part = isFullStep ? successor(part, step - 1) : centre(part);
+  }
+  auto secondStep{isFullStep ? step - 1 : step};
+  auto result{join(
+      successor(join(parts[0], parts[1], parts[3], parts[4]), secondStep),
+      successor(join(parts[1], parts[2], parts[4], parts[5]), secondStep),
+      successor(join(parts[3], parts[4], parts[6], parts[7]), secondStep),
+      successor(join(parts[4], parts[5], parts[7], parts[8]), secondStep))};
+  m_nodes[id].result = result;
+  m_nodes[id].resultStep = static_cast<std::uint8_t>(step);
+  return result;
+}
+
+// Evolves the inner 2x2 cells of a 4x4 node by one generation.
+HashLife::NodeId HashLife::evolveLeaf(NodeId id) {
+  auto node{m_nodes[id]};
+  unsigned cells{0};
+  NodeId quadrants[4]{node.nw, node.ne, node.sw, node.se};
+  for (unsigned quadrant = 0; quadrant < 4; quadrant++) {
+    auto child{m_nodes[quadrants[quadrant]]};
+    NodeId children[4]{child.nw, child.ne, child.sw, child.se};
+    for (unsigned cell = 0; cell < 4; cell++) {
+      if (children[cell] == f_aliveCell) {
+        auto col{(quadrant % 2) * 2 + cell % 2};
+        auto row{(quadrant / 2) * 2 + cell / 2};
+        cells |= 1U << (row * f_leafSize + col);
+      }
+    }
+  }
+  auto evolveCell{[this, cells](unsigned col, unsigned row) {
+    unsigned count{0};
+    for (auto r = row - 1; r <= row + 1; r++) {
+      for (auto c = col - 1; c <= col + 1; c++) {
+        if (r != row || c != col) {
+          count += (cells >> (r * f_leafSize + c)) & 1U;
+        }
+      }
+    }
+    auto isAlive{((cells >> (row * f_leafSize + col)) & 1U) != 0};
+    auto rule{isAlive ? m_rule.survivalMask : m_rule.birthMask};
+    return ((rule >> count) & 1U) != 0 ? f_aliveCell : f_deadCell;
+  }};
+  return join(evolveCell(1, 1), evolveCell(2, 1), evolveCell(1, 2),
+              evolveCell(2, 2));
+}
+
+HashLife::NodeId HashLife::build(const Grid &cells, std::size_t level,
+                                 std::size_t col, std::size_t row) {
+  if (col >= cells.width() || row >= cells.height()) {
+    return emptyNode(level);
+  }
+  if (level == 0) {
+    return cells.at(col, row) ? f_aliveCell : f_deadCell;
+  }
+  auto size{std::size_t{1} << level};
+  if (level >= f_emptyCheckLevel && isEmptyRegion(cells, col, row, size)) {
+    return emptyNode(level);
+  }
+  auto half{size / 2};
+  auto nw{build(cells, level - 1, col, row)};
+  auto ne{build(cells, level - 1, col + half, row)};
+  auto sw{build(cells, level - 1, col, row + half)};
+  auto se{build(cells, level - 1, col + half, row + half)};
+  return join(nw, ne, sw, se);
+}
+
+HashLife::NodeId HashLife::build(std::vector<Chunk>::iterator first,
+                                 std::vector<Chunk>::iterator last,
+                                 std::size_t level, SparseLife::Coord col,
+                                 SparseLife::Coord row) {
+  if (first == last) {
+    return emptyNode(level);
+  }
+  if (level == f_chunkLevel) {
+    return first->id;
+  }
+  auto half{std::int64_t{1} << (level - 1)};
+  auto south{std::partition(
+      first, last, [row, half](const auto &a) { return a.row < row + half; })};
+  auto northEast{std::partition(
+      first, south, [col, half](const auto &a) { return a.col < col + half; })};
+  auto southEast{std::partition(
+      south, last, [col, half](const auto &a) { return a.col < col + half; })};
+  auto nw{build(first, northEast, level - 1, col, row)};
+  auto ne{build(northEast, south, level - 1, col + half, row)};
+  auto sw{build(south, southEast, level - 1, col, row + half)};
+  auto se{build(southEast, last, level - 1, col + half, row + half)};
+  return join(nw, ne, sw, se);
+}
+
+void HashLife::expand() {
+  auto node{m_nodes[m_root]};
+  auto empty{emptyNode(node.level - 1U)};
+  auto nw{join(empty, empty, empty, node.nw)};
+  auto ne{join(empty, empty, node.ne, empty)};
+  auto sw{join(empty, node.sw, empty, empty)};
+  auto se{join(node.se, empty, empty, empty)};
+  m_root = join(nw, ne, sw, se);
+  auto offset{std::int64_t{1} << (node.level - 1)};
+  m_originCol -= offset;
+  m_originRow -= offset;
+}
+
+void HashLife::mark(NodeId id, bool keepResults) {
+  auto &node{m_nodes[id]};
+  if (node.isMarked) {
+    return;
+  }
+  node.isMarked = true;
+  auto children{node};
+  mark(children.nw, keepResults);
+  mark(children.ne, keepResults);
+  mark(children.sw, keepResults);
+  mark(children.se, keepResults);
+  if (keepResults && children.result != f_noNode) {
+    mark(children.result, keepResults);
+  }
+}
+
+void HashLife::rehash(std::size_t bucketCount) {
+  m_buckets.assign(bucketCount, f_noNode);
+  for (auto id = static_cast<NodeId>(f_aliveCell + 1); id < m_nodes.size();
+       id++) {
+    auto &node{m_nodes[id]};
+    if (node.level == f_freeLevel) {
+      continue;
+    }
+    auto &bucket{
+        m_buckets[hashOf(node.nw, node.ne, node.sw, node.se) &
+                  (bucketCount - 1)]};
+    node.next = bucket;
+    bucket = id;
+  }
+}
+
+void HashLife::store(Grid &cells, NodeId id, std::int64_t col,
+                     std::int64_t row) const {
+  const auto &node{m_nodes[id]};
+  auto size{std::int64_t{1} << node.level};
+  if (node.population == 0 || col >= static_cast<std::int64_t>(cells.width()) ||
+      row >= static_cast<std::int64_t>(cells.height()) || col + size <= 0 ||
+      row + size <= 0) {
+    return;
+  }
+  if (node.level == 0) {
+    cells.set(static_cast<std::size_t>(col), static_cast<std::size_t>(row),
+              true);
+    return;
+  }
+  auto half{size / 2};
+  store(cells, node.nw, col, row);
+  store(cells, node.ne, col + half, row);
+  store(cells, node.sw, col, row + half);
+  store(cells, node.se, col + half, row + half);
+}
+
+void HashLife::store(SparseLife &cells, NodeId id, std::int64_t col,
+                     std::int64_t row) const {
+  const auto &node{m_nodes[id]};
+  if (node.population == 0) {
+    return;
+  }
+  if (node.level == 0) {
+    cells.set(col, row, true);
+    return;
+  }
+  auto half{std::int64_t{1} << (node.level - 1)};
+  store(cells, node.nw, col, row);
+  store(cells, node.ne, col + half, row);
+  store(cells, node.sw, col, row + half);
+  store(cells, node.se, col + half, row + half);
+}
@@ -0,0 +1,118 @@
+#ifndef GAME_OF_LIFE_HASH_LIFE_HPP
+#define GAME_OF_LIFE_HASH_LIFE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "Grid.hpp"
+#include "Rule.hpp"
+#include "SparseLife.hpp"
+
+// HashLife engine: the plane is a quadtree of hash-consed nodes, and every
+// node memoizes its centre advanced by a power of two generations, so regular
+// patterns can be advanced by 2^k generations in a single call. The plane is
+// unbounded; load() and store() map it onto a grid with its top-left corner
+// at the origin, or onto a sparse plane with the same coordinates.
+class HashLife {
+public:
+  using NodeId = std::uint32_t;
+
+  struct Quadrants {
+    NodeId nw;
+    NodeId ne;
+    NodeId sw;
+    NodeId se;
+  };
+
+  // Inclusive corners of the smallest rectangle holding every live cell.
+  struct Bounds {
+    std::int64_t left;
+    std::int64_t top;
+    std::int64_t right;
+    std::int64_t bottom;
+  };
+
+  static constexpr std::size_t maxLog2Generations{48};
+
+  HashLife();
+
+  std::size_t nodeCount() const;
+  std::size_t memoryUsage() const;
+  std::size_t memoryLimit() const;
+  std::uint64_t population() const;
+  std::optional<Bounds> bounds() const;
+  // Stores the plane shifted by (col, row).
+  void store(Grid &cells, std::int64_t col = 0, std::int64_t row = 0) const;
+  void store(SparseLife &cells, std::int64_t col = 0,
+             std::int64_t row = 0) const;
+
+  // Node level access for quadtree file formats. Level 0 nodes are cells.
+  NodeId root() const;
+  NodeId cell(bool isAlive) const;
+  std::size_t level(NodeId id) const;
+  std::uint64_t population(NodeId id) const;
+  Quadrants quadrants(NodeId id) const;
+  NodeId emptyNode(std::size_t level);
+  NodeId join(NodeId nw, NodeId ne, NodeId sw, NodeId se);
+  void setRoot(NodeId id, std::int64_t col, std::int64_t row);
+
+  void setMemoryLimit(std::size_t bytes);
+  void setRule(Rule rule);
+  void load(const Grid &cells);
+  void load(const SparseLife &cells);
+  void advance(std::size_t log2Generations);
+  void collectGarbage(bool keepResults);
+
+private:
+
+  struct Chunk {
+    SparseLife::Coord col;
+    SparseLife::Coord row;
+    NodeId id;
+  };
+
+  struct Node {
+    NodeId nw;
+    NodeId ne;
+    NodeId sw;
+    NodeId se;
+    NodeId result;
+    NodeId next;
+    std::uint64_t population;
+    std::uint8_t level;
+    std::uint8_t resultStep;
+    bool isMarked;
+  };
+
+  NodeId centre(NodeId id);
+  NodeId successor(NodeId id, std::size_t step);
+  NodeId evolveLeaf(NodeId id);
+  NodeId build(const Grid &cells, std::size_t level, std::size_t col,
+               std::size_t row);
+  NodeId build(std::vector<Chunk>::iterator first,
+               std::vector<Chunk>::iterator last, std::size_t level,
+               SparseLife::Coord col, SparseLife::Coord row);
+  void expand();
+  void mark(NodeId id, bool keepResults);
+  void rehash(std::size_t bucketCount);
+  void store(Grid &cells, NodeId id, std::int64_t col,
+             std::int64_t row) const;
+  void store(SparseLife &cells, NodeId id, std::int64_t col,
+             std::int64_t row) const;
+
+  std::vector<Node> m_nodes;
+  std::vector<NodeId> m_buckets;
+  std::vector<NodeId> m_emptyNodes;
+  NodeId m_freeNodes;
+  std::size_t m_freeNodeCount;
+  std::size_t m_memoryLimit;
+  bool m_isMemoryLimited;
+  Rule m_rule;
+  NodeId m_root;
+  std::int64_t m_originCol;
+  std::int64_t m_originRow;
+};
+
+#endif
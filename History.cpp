@@ -0,0 +1,214 @@
+#include "History.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+namespace {
+constexpr std::size_t f_keyframeInterval{64};
+// Unchanged words bridged to keep a run going, as a zero costs less than a
+// new run.
+constexpr std::size_t f_maxRunGap{2};
+} // namespace
+
+// Defined ahead of record so it is inlined into the scan.
+inline void History::Words::add(std::size_t index, Grid::Word value) {
+  auto runEnd{runs.empty() ? index + 1
+                           : runs.back().start + runs.back().length};
+  if (runEnd == index) {
+    runs.back().length++;
+  } else if (index > runEnd && index - runEnd <= f_maxRunGap) {
+    values.resize(values.size() + index - runEnd);
+    runs.back().length += index - runEnd + 1;
+  } else {
+    runs.push_back({index, 1});
+  }
+  values.push_back(value);
+}
+
+History::History()
+    : m_memoryLimit{0}, m_memoryUsage{0}, m_stepsMemoryUsage{0},
+      m_newestGeneration{0}, m_steps{}, m_keyframes{}, m_scratch{} {}
+
+std::size_t History::memoryLimit() const { return m_memoryLimit; }
+
+std::size_t History::memoryUsage() const { return m_memoryUsage; }
+
+bool History::empty() const { return m_steps.empty() && m_keyframes.empty(); }
+
+std::size_t History::oldestGeneration() const {
+  auto oldest{m_keyframes.empty() ? std::numeric_limits<std::size_t>::max()
+                                  : m_keyframes.front().generation};
+  if (!m_steps.empty()) {
+    oldest = std::min(oldest, m_steps.front().previousGeneration);
+  }
+  return oldest;
+}
+
+// A limit of zero turns recording off.
+void History::setMemoryLimit(std::size_t bytes) {
+  m_memoryLimit = bytes;
+  evict();
+}
+
+void History::clear() {
+  m_steps.clear();
+  m_keyframes.clear();
+  m_memoryUsage = 0;
+  m_stepsMemoryUsage = 0;
+}
+
+void History::record(const Grid &previous, std::size_t previousGeneration,
+                     const Grid &current, std::size_t generation,
+                     const TileMap *tiles) {
+  if (m_memoryLimit == 0) {
+    return;
+  }
+  if (!empty() && m_newestGeneration != previousGeneration) {
+    clear();
+  }
+  m_newestGeneration = generation;
+  if (m_keyframes.empty()) {
+    addKeyframe(previous, previousGeneration);
+  }
+  const auto *previousWords{previous.words()};
+  const auto *currentWords{current.words()};
+  m_scratch.runs.clear();
+  m_scratch.values.clear();
+  auto addChanges{[&](std::size_t first, std::size_t last) {
+    for (auto index = first; index < last; index++) {
+      if (auto change{previousWords[index] ^ currentWords[index]}) {
+        m_scratch.add(index, change);
+      }
+    }
+  }};
+  if (tiles == nullptr) {
+    addChanges(0, current.wordCount());
+  } else {
+    // Row by row over the spans of evolved tiles, so the indices grow and
+    // neighbouring changes share runs.
+    std::vector<std::pair<std::size_t, std::size_t>> spans;
+    for (std::size_t tileRow = 0; tileRow < tiles->rows(); tileRow++) {
+      spans.clear();
+      for (std::size_t tileCol = 0; tileCol < tiles->columns(); tileCol++) {
+        if (!tiles->isActive(tileCol, tileRow)) {
+          continue;
+        }
+        if (!spans.empty() && spans.back().second == tileCol) {
+          spans.back().second++;
+        } else {
+          spans.emplace_back(tileCol, tileCol + 1);
+        }
+      }
+      auto lastRow{std::min((tileRow + 1) * TileMap::tileHeight,
+                            current.height())};
+      for (auto row = tileRow * TileMap::tileHeight;
+           row < lastRow && !spans.empty(); row++) {
+        auto rowIndex{
+            static_cast<std::size_t>(current.row(row) - currentWords)};
+        for (const auto &[first, last] : spans) {
+          addChanges(rowIndex + first, rowIndex + last);
+        }
+      }
+    }
+  }
+  // Copied out of the scratch buffer so every step is allocated at its size.
+  Step step{previousGeneration, generation, m_scratch};
+  auto stepMemoryUsage{memoryUsage(step.changes)};
+  m_memoryUsage += stepMemoryUsage;
+  m_stepsMemoryUsage += stepMemoryUsage;
+  m_steps.push_back(std::move(step));
+  if (generation / f_keyframeInterval !=
+      m_keyframes.back().generation / f_keyframeInterval) {
+    addKeyframe(current, generation);
+  }
+  evict();
+}
+
+// Undoes recorded steps while they reach the target, and otherwise falls
+// back to the newest keyframe before it, dropping every step after that.
+// Targets older than the history are clamped to its oldest generation.
+std::size_t History::rewind(Grid &cells, std::size_t generation,
+                            std::size_t target) {
+  if (generation != m_newestGeneration) {
+    clear();
+  }
+  if (target >= generation || empty()) {
+    return generation;
+  }
+  target = std::max(target, oldestGeneration());
+  if (!m_steps.empty() && target >= m_steps.front().previousGeneration) {
+    auto *words{cells.words()};
+    while (!m_steps.empty() && m_steps.back().generation > target) {
+      const auto &changes{m_steps.back().changes};
+      const auto *values{changes.values.data()};
+      for (const auto &run : changes.runs) {
+        for (std::size_t i = 0; i < run.length; i++) {
+          words[run.start + i] ^= *values++;
+        }
+      }
+      generation = m_steps.back().previousGeneration;
+      auto stepMemoryUsage{memoryUsage(changes)};
+      m_memoryUsage -= stepMemoryUsage;
+      m_stepsMemoryUsage -= stepMemoryUsage;
+      m_steps.pop_back();
+    }
+  } else {
+    const auto &frame{*std::find_if(
+        m_keyframes.crbegin(), m_keyframes.crend(),
+        [target](const auto &frame) { return frame.generation <= target; })};
+    cells.clear();
+    auto *words{cells.words()};
+    const auto *values{frame.cells.values.data()};
+    for (const auto &run : frame.cells.runs) {
+      std::copy_n(values, run.length, words + run.start);
+      values += run.length;
+    }
+    generation = frame.generation;
+    m_memoryUsage -= m_stepsMemoryUsage;
+    m_stepsMemoryUsage = 0;
+    m_steps.clear();
+  }
+  while (!m_keyframes.empty() && m_keyframes.back().generation > generation) {
+    m_memoryUsage -= memoryUsage(m_keyframes.back().cells);
+    m_keyframes.pop_back();
+  }
+  m_newestGeneration = generation;
+  return generation;
+}
+
+std::size_t History::memoryUsage(const Words &words) {
+  return words.runs.capacity() * sizeof(Run) +
+         words.values.capacity() * sizeof(Grid::Word) + sizeof(Step);
+}
+
+void History::addKeyframe(const Grid &cells, std::size_t generation) {
+  Keyframe keyframe{generation, {}};
+  const auto *words{cells.words()};
+  for (std::size_t index = 0; index < cells.wordCount(); index++) {
+    if (words[index] != 0) {
+      keyframe.cells.add(index, words[index]);
+    }
+  }
+  keyframe.cells.runs.shrink_to_fit();
+  keyframe.cells.values.shrink_to_fit();
+  m_memoryUsage += memoryUsage(keyframe.cells);
+  m_keyframes.push_back(std::move(keyframe));
+}
+
+// Recent steps are worth more than old ones, and keyframes are cheaper per
+// generation covered, so steps give way first once they hold half the limit.
+void History::evict() {
+  while (m_memoryUsage > m_memoryLimit && !empty()) {
+    if (!m_steps.empty() &&
+        (m_stepsMemoryUsage * 2 > m_memoryLimit || m_keyframes.size() <= 1)) {
+      auto stepMemoryUsage{memoryUsage(m_steps.front().changes)};
+      m_memoryUsage -= stepMemoryUsage;
+      m_stepsMemoryUsage -= stepMemoryUsage;
+      m_steps.pop_front();
+    } else {
+      m_memoryUsage -= memoryUsage(m_keyframes.front().cells);
+      m_keyframes.pop_front();
+    }
+  }
+}
@@ -0,0 +1,79 @@
+#ifndef GAME_OF_LIFE_HISTORY_HPP
+#define GAME_OF_LIFE_HISTORY_HPP
+
+#include <cstddef>
+#include <deque>
+#include <vector>
+
+#include "Grid.hpp"
+#include "TileMap.hpp"
+
+// Bounded record of past generations of a grid. Every recorded step keeps the
+// words it changed, XORed with their previous value, so the newest steps can
+// be undone one by one. Every few generations a keyframe keeps the whole grid
+// as well, so once older steps are evicted to stay within the memory limit a
+// generation can still be rebuilt by simulating forward from the keyframe
+// before it.
+class History {
+public:
+  History();
+
+  std::size_t memoryLimit() const;
+  std::size_t memoryUsage() const;
+  bool empty() const;
+  // Oldest generation that can be rebuilt, exactly or by re-simulating.
+  std::size_t oldestGeneration() const;
+
+  void setMemoryLimit(std::size_t bytes);
+  void clear();
+  // Records the step from previous to current. Only the words of the tiles
+  // that were evolved are compared when tiles are given.
+  void record(const Grid &previous, std::size_t previousGeneration,
+              const Grid &current, std::size_t generation,
+              const TileMap *tiles = nullptr);
+  // Moves cells back from generation towards target and returns the
+  // generation they hold afterwards. It is below target when the steps in
+  // between were evicted and the caller has to simulate forward to reach it.
+  std::size_t rewind(Grid &cells, std::size_t generation, std::size_t target);
+
+private:
+  // Runs of consecutive grid words, addressed by their index in
+  // Grid::words(), with the values of all runs stored back to back.
+  struct Run {
+    std::size_t start;
+    std::size_t length;
+  };
+
+  struct Words {
+    std::vector<Run> runs;
+    std::vector<Grid::Word> values;
+
+    void add(std::size_t index, Grid::Word value);
+  };
+
+  struct Step {
+    std::size_t previousGeneration;
+    std::size_t generation;
+    Words changes;
+  };
+
+  struct Keyframe {
+    std::size_t generation;
+    Words cells;
+  };
+
+  static std::size_t memoryUsage(const Words &words);
+
+  void addKeyframe(const Grid &cells, std::size_t generation);
+  void evict();
+
+  std::size_t m_memoryLimit;
+  std::size_t m_memoryUsage;
+  std::size_t m_stepsMemoryUsage;
+  std::size_t m_newestGeneration;
+  std::deque<Step> m_steps;
+  std::deque<Keyframe> m_keyframes;
+  Words m_scratch;
+};
+
+#endif
@@ -0,0 +1,164 @@
+#include "Kernel.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bitset>
+
+#include "KernelSimd.hpp"
+
+#if defined(GAME_OF_LIFE_KERNEL_X86_64) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace {
+using Word = Grid::Word;
+
+// Longest run of active tiles evolved at once, so that the words that changed
+// in it are tracked on the stack.
+constexpr std::size_t f_maxRunWords{64};
+
+bool cpuSupports(kernel::Isa isa) {
+#if defined(GAME_OF_LIFE_KERNEL_X86_64) && defined(_MSC_VER)
+  int info[4];
+  __cpuid(info, 1);
+  auto hasOsAvx{(info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 &&
+                (_xgetbv(0) & 0x6) == 0x6};
+  auto hasOsAvx512{hasOsAvx && (_xgetbv(0) & 0xe0) == 0xe0};
+  __cpuidex(info, 7, 0);
+  switch (isa) {
+  case kernel::Isa::Avx512:
+    return hasOsAvx512 && (info[1] & (1 << 16)) != 0;
+  case kernel::Isa::Avx2:
+    return hasOsAvx && (info[1] & (1 << 5)) != 0;
+  default:
+    return true;
+  }
+#elif defined(GAME_OF_LIFE_KERNEL_X86_64)
+  switch (isa) {
+  case kernel::Isa::Avx512:
+    return __builtin_cpu_supports("avx512f");
+  case kernel::Isa::Avx2:
+    return __builtin_cpu_supports("avx2");
+  default:
+    return true;
+  }
+#else
+  return isa == kernel::Isa::Scalar;
+#endif
+}
+
+kernel::RowFunction toRowFunction(kernel::Isa isa, Rule rule) {
+  switch (isa) {
+#ifdef GAME_OF_LIFE_KERNEL_X86_64
+  case kernel::Isa::Avx512:
+    return kernel::detail::selectRowFunctionAvx512(rule);
+  case kernel::Isa::Avx2:
+    return kernel::detail::selectRowFunctionAvx2(rule);
+  case kernel::Isa::Sse2:
+    return kernel::detail::selectRowFunctionSse2(rule);
+#endif
+  default:
+    return selectRowFunction<ScalarOps>(rule);
+  }
+}
+
+kernel::Isa detectIsa() {
+  for (auto isa : {kernel::Isa::Avx512, kernel::Isa::Avx2, kernel::Isa::Sse2}) {
+    if (cpuSupports(isa)) {
+      return isa;
+    }
+  }
+  return kernel::Isa::Scalar;
+}
+
+kernel::Isa f_isa{detectIsa()};
+} // namespace
+
+namespace kernel {
+Isa isa() { return f_isa; }
+
+bool isSupported(Isa isa) { return cpuSupports(isa); }
+
+bool setIsa(Isa isa) {
+  if (!cpuSupports(isa)) {
+    return false;
+  }
+  f_isa = isa;
+  return true;
+}
+
+const char *toString(Isa isa) {
+  switch (isa) {
+  case Isa::Avx512:
+    return "AVX-512";
+  case Isa::Avx2:
+    return "AVX2";
+  case Isa::Sse2:
+    return "SSE2";
+  default:
+    return "Scalar";
+  }
+}
+
+RuleKernel select(Rule rule) {
+  return {rule, f_isa, toRowFunction(f_isa, rule),
+          selectRowFunction<ScalarOps>(rule)};
+}
+
+StepChange step(const Grid &current, Grid &next, Grid &visited,
+                TileMap &tiles, std::size_t tileRow, std::size_t firstCol,
+                std::size_t lastCol, const RuleKernel &kernel) {
+  using Bits = std::bitset<Grid::bitsPerWord>;
+  StepChange change{0, 0};
+  auto words{current.wordsPerRow()};
+  auto stride{current.stride()};
+  auto lastWordMask{current.lastWordMask()};
+  auto firstRow{tileRow * TileMap::tileHeight};
+  auto lastRow{std::min(firstRow + TileMap::tileHeight, current.height())};
+  std::array<Word, f_maxRunWords> differences;
+  for (auto first = firstCol; first < lastCol;) {
+    if (!tiles.isActive(first, tileRow)) {
+      tiles.setChanged(first++, tileRow, false);
+      continue;
+    }
+    auto last{first + 1};
+    while (last < lastCol && last - first < f_maxRunWords &&
+           tiles.isActive(last, tileRow)) {
+      last++;
+    }
+    differences.fill(0);
+    for (auto row = firstRow; row < lastRow; row++) {
+      const auto *middle{current.row(row) + first};
+      auto *output{next.row(row) + first};
+      auto *seen{visited.row(row) + first};
+      auto count{last - first};
+      auto done{kernel.evolveRow(middle - stride, middle, middle + stride,
+                                 output, count, kernel.rule)};
+      kernel.evolveTail(middle - stride + done, middle + done,
+                        middle + stride + done, output + done, count - done,
+                        kernel.rule);
+      if (last == words) {
+        output[count - 1] &= lastWordMask;
+      }
+      for (std::size_t word = 0; word < count; word++) {
+        seen[word] |= output[word];
+        differences[word] |= output[word] ^ middle[word];
+        change.population +=
+            static_cast<std::ptrdiff_t>(Bits{output[word]}.count()) -
+            static_cast<std::ptrdiff_t>(Bits{middle[word]}.count());
+      }
+      // Branch free, as words that did not change cancel out.
+      auto index{row * words + first};
+      for (std::size_t word = 0; word < count; word++) {
+        change.hash ^= Grid::hashWord(index + word, middle[word]) ^
+                       Grid::hashWord(index + word, output[word]);
+      }
+    }
+    for (auto word = first; word < last; word++) {
+      tiles.setChanged(word, tileRow, differences[word - first] != 0);
+    }
+    first = last;
+  }
+  return change;
+}
+} // namespace kernel
@@ -0,0 +1,57 @@
+#ifndef GAME_OF_LIFE_KERNEL_HPP
+#define GAME_OF_LIFE_KERNEL_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+#include "Grid.hpp"
+#include "Rule.hpp"
+#include "TileMap.hpp"
+
+namespace kernel {
+enum class Isa { Scalar, Sse2, Avx2, Avx512 };
+
+// Instruction set used by select(). Defaults to the widest one the CPU
+// supports.
+Isa isa();
+bool isSupported(Isa isa);
+bool setIsa(Isa isa);
+const char *toString(Isa isa);
+
+// Evolves as many leading words of a row as fit in whole vectors and returns
+// how many were written.
+using RowFunction = std::size_t (*)(const Grid::Word *above,
+                                    const Grid::Word *middle,
+                                    const Grid::Word *below,
+                                    Grid::Word *output, std::size_t words,
+                                    Rule rule);
+
+// Row kernels for one rule on one instruction set. Common rules get kernels
+// with the rule compiled in; the rest share a generic one. Selected once
+// whenever the rule changes, so step() does no per-generation dispatch.
+struct RuleKernel {
+  Rule rule;
+  Isa isa;
+  RowFunction evolveRow;
+  RowFunction evolveTail;
+};
+
+RuleKernel select(Rule rule);
+
+// Change in population and in Grid::hash() made by a step.
+struct StepChange {
+  std::ptrdiff_t population;
+  std::uint64_t hash;
+};
+
+// Advances the active tiles of one row of `tiles`, from column `firstCol` up
+// to `lastCol` excluded, one generation from `current` into `next`, marks
+// every cell alive in them in `visited`, records which of them changed, and
+// returns the resulting change of the grid. Distinct tiles may be stepped
+// concurrently.
+StepChange step(const Grid &current, Grid &next, Grid &visited,
+                TileMap &tiles, std::size_t tileRow, std::size_t firstCol,
+                std::size_t lastCol, const RuleKernel &kernel);
+} // namespace kernel
+
+#endif
@@ -0,0 +1,49 @@
+#include "KernelSimd.hpp"
+
+#ifdef GAME_OF_LIFE_KERNEL_X86_64
+#include <immintrin.h>
+
+namespace {
+struct Avx2Ops {
+  using Vector = __m256i;
+
+  static constexpr std::size_t lanes{4};
+
+  static Vector load(const Grid::Word *word) {
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(word));
+  }
+  static void store(Grid::Word *word, Vector value) {
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(word), value);
+  }
+  static Vector west(const Grid::Word *word) {
+    return _mm256_or_si256(_mm256_slli_epi64(load(word), 1),
+                           _mm256_srli_epi64(load(word - 1), 63));
+  }
+  static Vector east(const Grid::Word *word) {
+    return _mm256_or_si256(_mm256_srli_epi64(load(word), 1),
+                           _mm256_slli_epi64(load(word + 1), 63));
+  }
+  static Vector zero() { return _mm256_setzero_si256(); }
+  static Vector bitNot(Vector a) {
+    return _mm256_xor_si256(a, _mm256_set1_epi32(-1));
+  }
+  static Vector bitAnd(Vector a, Vector b) { return _mm256_and_si256(a, b); }
+  static Vector bitOr(Vector a, Vector b) { return _mm256_or_si256(a, b); }
+  static Vector bitXor(Vector a, Vector b) { return _mm256_xor_si256(a, b); }
+  static Vector andNot(Vector a, Vector b) { return _mm256_andnot_si256(a, b); }
+  static Vector xor3(Vector a, Vector b, Vector c) {
+    return _mm256_xor_si256(_mm256_xor_si256(a, b), c);
+  }
+  static Vector majority(Vector a, Vector b, Vector c) {
+    return _mm256_or_si256(_mm256_and_si256(a, b),
+                           _mm256_and_si256(c, _mm256_xor_si256(a, b)));
+  }
+};
+} // namespace
+
+namespace kernel::detail {
+RowFunction selectRowFunctionAvx2(Rule rule) {
+  return selectRowFunction<Avx2Ops>(rule);
+}
+} // namespace kernel::detail
+#endif
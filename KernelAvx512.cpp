@@ -0,0 +1,58 @@
+#include "KernelSimd.hpp"
+
+#ifdef GAME_OF_LIFE_KERNEL_X86_64
+#include <immintrin.h>
+
+// GCC flags the deliberately undefined pass-through operand that its own
+// AVX-512 intrinsics use internally.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+namespace {
+constexpr int f_xor3Table{0x96};
+constexpr int f_majorityTable{0xe8};
+
+struct Avx512Ops {
+  using Vector = __m512i;
+
+  static constexpr std::size_t lanes{8};
+
+  static Vector load(const Grid::Word *word) {
+    return _mm512_loadu_si512(word);
+  }
+  static void store(Grid::Word *word, Vector value) {
+    _mm512_storeu_si512(word, value);
+  }
+  static Vector west(const Grid::Word *word) {
+    return _mm512_or_si512(_mm512_slli_epi64(load(word), 1),
+                           _mm512_srli_epi64(load(word - 1), 63));
+  }
+  static Vector east(const Grid::Word *word) {
+    return _mm512_or_si512(_mm512_srli_epi64(load(word), 1),
+                           _mm512_slli_epi64(load(word + 1), 63));
+  }
+  static Vector zero() { return _mm512_setzero_si512(); }
+  static Vector bitNot(Vector a) {
+    return _mm512_xor_si512(a, _mm512_set1_epi64(-1));
+  }
+  static Vector bitAnd(Vector a, Vector b) { return _mm512_and_si512(a, b); }
+  static Vector bitOr(Vector a, Vector b) { return _mm512_or_si512(a, b); }
+  static Vector bitXor(Vector a, Vector b) { return _mm512_xor_si512(a, b); }
+  static Vector andNot(Vector a, Vector b) { return _mm512_andnot_si512(a, b); }
+  static Vector xor3(Vector a, Vector b, Vector c) {
+    return _mm512_ternarylogic_epi64(a, b, c, f_xor3Table);
+  }
+  static Vector majority(Vector a, Vector b, Vector c) {
+    return _mm512_ternarylogic_epi64(a, b, c, f_majorityTable);
+  }
+};
+} // namespace
+
+namespace kernel::detail {
+RowFunction selectRowFunctionAvx512(Rule rule) {
+  return selectRowFunction<Avx512Ops>(rule);
+}
+} // namespace kernel::detail
+#endif
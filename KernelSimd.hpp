@@ -0,0 +1,210 @@
+#ifndef GAME_OF_LIFE_KERNEL_SIMD_HPP
+#define GAME_OF_LIFE_KERNEL_SIMD_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#include "Grid.hpp"
+#include "Kernel.hpp"
+#include "Rule.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define GAME_OF_LIFE_KERNEL_X86_64
+#endif
+
+namespace kernel::detail {
+// Row kernels of each instruction set for a given rule.
+RowFunction selectRowFunctionSse2(Rule rule);
+RowFunction selectRowFunctionAvx2(Rule rule);
+RowFunction selectRowFunctionAvx512(Rule rule);
+} // namespace kernel::detail
+
+// Kept in an unnamed namespace so that every instruction set translation unit
+// gets its own copy and the linker never mixes them up. ScalarOps is the
+// portable instantiation, also used by engines that evolve single words.
+namespace {
+constexpr std::size_t f_maxNeighbourCount{8};
+constexpr auto f_topBit{Grid::bitsPerWord - 1};
+
+struct ScalarOps {
+  using Vector = Grid::Word;
+
+  static constexpr std::size_t lanes{1};
+
+  static Vector load(const Grid::Word *word) { return *word; }
+  static void store(Grid::Word *word, Vector value) { *word = value; }
+  static Vector west(const Grid::Word *word) {
+    return (word[0] << 1) | (word[-1] >> f_topBit);
+  }
+  static Vector east(const Grid::Word *word) {
+    return (word[0] >> 1) | (word[1] << f_topBit);
+  }
+  static Vector zero() { return 0; }
+  static Vector bitNot(Vector a) { return ~a; }
+  static Vector bitAnd(Vector a, Vector b) { return a & b; }
+  static Vector bitOr(Vector a, Vector b) { return a | b; }
+  static Vector bitXor(Vector a, Vector b) { return a ^ b; }
+  static Vector andNot(Vector a, Vector b) { return ~a & b; }
+  static Vector xor3(Vector a, Vector b, Vector c) { return a ^ b ^ c; }
+  static Vector majority(Vector a, Vector b, Vector c) {
+    return (a & b) | (c & (a ^ b));
+  }
+};
+
+// Rule only known at run time.
+struct DynamicRule {
+  std::uint16_t birthMask;
+  std::uint16_t survivalMask;
+};
+
+// Rule known at compile time, so that only the neighbour counts it uses are
+// matched.
+template <std::uint16_t BirthMask, std::uint16_t SurvivalMask>
+struct StaticRule {};
+
+template <typename Ops> struct NeighbourCount {
+  typename Ops::Vector centre;
+  typename Ops::Vector c0;
+  typename Ops::Vector c1;
+  typename Ops::Vector c2;
+  typename Ops::Vector c3;
+};
+
+template <typename Ops>
+inline auto matchNeighbourCount(std::size_t count,
+                                const NeighbourCount<Ops> &counts) {
+  auto match{(count & 1) ? counts.c0 : Ops::bitNot(counts.c0)};
+  match = Ops::bitAnd(match, (count & 2) ? counts.c1 : Ops::bitNot(counts.c1));
+  match = Ops::bitAnd(match, (count & 4) ? counts.c2 : Ops::bitNot(counts.c2));
+  return Ops::bitAnd(match, (count & 8) ? counts.c3 : Ops::bitNot(counts.c3));
+}
+
+// Counts the eight neighbours of every cell in a vector into four bit planes
+// (c0 being the least significant).
+template <typename Ops>
+inline auto countNeighbours(const Grid::Word *above, const Grid::Word *middle,
+                            const Grid::Word *below) {
+  auto aboveWest{Ops::west(above)};
+  auto aboveEast{Ops::east(above)};
+  auto belowWest{Ops::west(below)};
+  auto belowEast{Ops::east(below)};
+  auto west{Ops::west(middle)};
+  auto east{Ops::east(middle)};
+  auto a0{Ops::xor3(aboveWest, Ops::load(above), aboveEast)};
+  auto a1{Ops::majority(aboveWest, Ops::load(above), aboveEast)};
+  auto b0{Ops::xor3(belowWest, Ops::load(below), belowEast)};
+  auto b1{Ops::majority(belowWest, Ops::load(below), belowEast)};
+  auto m0{Ops::bitXor(west, east)};
+  auto m1{Ops::bitAnd(west, east)};
+  auto s0{Ops::bitXor(a0, b0)};
+  auto s1{Ops::xor3(a1, b1, Ops::bitAnd(a0, b0))};
+  auto s2{Ops::majority(a1, b1, Ops::bitAnd(a0, b0))};
+  auto carry{Ops::majority(s1, m1, Ops::bitAnd(s0, m0))};
+  return NeighbourCount<Ops>{Ops::load(middle), Ops::bitXor(s0, m0),
+                             Ops::xor3(s1, m1, Ops::bitAnd(s0, m0)),
+                             Ops::bitXor(s2, carry), Ops::bitAnd(s2, carry)};
+}
+
+template <typename Ops>
+inline auto applyRule(const NeighbourCount<Ops> &counts, DynamicRule rule) {
+  auto born{Ops::zero()};
+  auto survives{Ops::zero()};
+  for (std::size_t count = 0; count <= f_maxNeighbourCount; count++) {
+    if ((rule.birthMask >> count) & 1) {
+      born = Ops::bitOr(born, matchNeighbourCount<Ops>(count, counts));
+    }
+    if ((rule.survivalMask >> count) & 1) {
+      survives = Ops::bitOr(survives, matchNeighbourCount<Ops>(count, counts));
+    }
+  }
+  return Ops::bitOr(Ops::bitAnd(counts.centre, survives),
+                    Ops::andNot(counts.centre, born));
+}
+
+template <typename Ops, std::uint16_t BirthMask, std::uint16_t SurvivalMask,
+          std::size_t... Counts>
+inline auto applyRule(const NeighbourCount<Ops> &counts,
+                      std::index_sequence<Counts...>) {
+  auto born{Ops::zero()};
+  auto survives{Ops::zero()};
+  ((born = ((BirthMask >> Counts) & 1)
+               ? Ops::bitOr(born, matchNeighbourCount<Ops>(Counts, counts))
+               : born),
+   ...);
+  ((survives = ((SurvivalMask >> Counts) & 1)
+                   ? Ops::bitOr(survives,
+                                matchNeighbourCount<Ops>(Counts, counts))
+                   : survives),
+   ...);
+  return Ops::bitOr(Ops::bitAnd(counts.centre, survives),
+                    Ops::andNot(counts.centre, born));
+}
+
+template <typename Ops, std::uint16_t BirthMask, std::uint16_t SurvivalMask>
+inline auto applyRule(const NeighbourCount<Ops> &counts,
+                      StaticRule<BirthMask, SurvivalMask>) {
+  if constexpr (Rule{BirthMask, SurvivalMask} == rules::conway) {
+    // Alive with three neighbours, or with two if it was alive already.
+    return Ops::bitAnd(
+        Ops::andNot(Ops::bitOr(counts.c2, counts.c3), counts.c1),
+        Ops::bitOr(counts.c0, counts.centre));
+  } else {
+    return applyRule<Ops, BirthMask, SurvivalMask>(
+        counts, std::make_index_sequence<f_maxNeighbourCount + 1>{});
+  }
+}
+
+template <typename Ops, typename RuleType>
+inline auto evolve(const Grid::Word *above, const Grid::Word *middle,
+                   const Grid::Word *below, RuleType rule) {
+  return applyRule<Ops>(countNeighbours<Ops>(above, middle, below), rule);
+}
+
+template <typename Ops, typename RuleType>
+inline std::size_t evolveRow(const Grid::Word *above, const Grid::Word *middle,
+                             const Grid::Word *below, Grid::Word *output,
+                             std::size_t words, RuleType rule) {
+  std::size_t word{0};
+  for (; word + Ops::lanes <= words; word += Ops::lanes) {
+    Ops::store(output + word,
+               evolve<Ops>(above + word, middle + word, below + word, rule));
+  }
+  return word;
+}
+
+template <typename Ops>
+std::size_t evolveDynamicRow(const Grid::Word *above, const Grid::Word *middle,
+                             const Grid::Word *below, Grid::Word *output,
+                             std::size_t words, Rule rule) {
+  return evolveRow<Ops>(above, middle, below, output, words,
+                        DynamicRule{rule.birthMask, rule.survivalMask});
+}
+
+template <typename Ops, const Rule &Known>
+std::size_t evolveStaticRow(const Grid::Word *above, const Grid::Word *middle,
+                            const Grid::Word *below, Grid::Word *output,
+                            std::size_t words, Rule) {
+  return evolveRow<Ops>(above, middle, below, output, words,
+                        StaticRule<Known.birthMask, Known.survivalMask>{});
+}
+
+// Picks the row kernel specialized for a common rule, or the generic one.
+template <typename Ops> kernel::RowFunction selectRowFunction(Rule rule) {
+  if (rule == rules::conway) {
+    return evolveStaticRow<Ops, rules::conway>;
+  }
+  if (rule == rules::highLife) {
+    return evolveStaticRow<Ops, rules::highLife>;
+  }
+  if (rule == rules::dayAndNight) {
+    return evolveStaticRow<Ops, rules::dayAndNight>;
+  }
+  if (rule == rules::seeds) {
+    return evolveStaticRow<Ops, rules::seeds>;
+  }
+  return evolveDynamicRow<Ops>;
+}
+} // namespace
+
+#endif
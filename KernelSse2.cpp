@@ -0,0 +1,49 @@
+#include "KernelSimd.hpp"
+
+#ifdef GAME_OF_LIFE_KERNEL_X86_64
+#include <emmintrin.h>
+
+namespace {
+struct Sse2Ops {
+  using Vector = __m128i;
+
+  static constexpr std::size_t lanes{2};
+
+  static Vector load(const Grid::Word *word) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i *>(word));
+  }
+  static void store(Grid::Word *word, Vector value) {
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(word), value);
+  }
+  static Vector west(const Grid::Word *word) {
+    return _mm_or_si128(_mm_slli_epi64(load(word), 1),
+                        _mm_srli_epi64(load(word - 1), 63));
+  }
+  static Vector east(const Grid::Word *word) {
+    return _mm_or_si128(_mm_srli_epi64(load(word), 1),
+                        _mm_slli_epi64(load(word + 1), 63));
+  }
+  static Vector zero() { return _mm_setzero_si128(); }
+  static Vector bitNot(Vector a) {
+    return _mm_xor_si128(a, _mm_set1_epi32(-1));
+  }
+  static Vector bitAnd(Vector a, Vector b) { return _mm_and_si128(a, b); }
+  static Vector bitOr(Vector a, Vector b) { return _mm_or_si128(a, b); }
+  static Vector bitXor(Vector a, Vector b) { return _mm_xor_si128(a, b); }
+  static Vector andNot(Vector a, Vector b) { return _mm_andnot_si128(a, b); }
+  static Vector xor3(Vector a, Vector b, Vector c) {
+    return _mm_xor_si128(_mm_xor_si128(a, b), c);
+  }
+  static Vector majority(Vector a, Vector b, Vector c) {
+    return _mm_or_si128(_mm_and_si128(a, b),
+                        _mm_and_si128(c, _mm_xor_si128(a, b)));
+  }
+};
+} // namespace
+
+namespace kernel::detail {
+RowFunction selectRowFunctionSse2(Rule rule) {
+  return selectRowFunction<Sse2Ops>(rule);
+}
+} // namespace kernel::detail
+#endif
@@ -0,0 +1,342 @@
+#include "MacrocellHelper.hpp"
+
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+constexpr auto f_macrocellFileExtension{".mc"};
+constexpr auto f_formatTag{"[M2]"};
+constexpr auto f_writerName{"(game-of-life)"};
+constexpr auto f_endOfLine{'\n'};
+constexpr auto f_commentSymbol{'#'};
+constexpr auto f_ruleTag{'R'};
+constexpr auto f_deadCellSymbol{'.'};
+constexpr auto f_aliveCellSymbol{'*'};
+constexpr auto f_endOfRowSymbol{'$'};
+constexpr std::size_t f_leafLevel{3};
+constexpr std::size_t f_leafSize{std::size_t{1} << f_leafLevel};
+constexpr std::size_t f_maxLevel{62};
+constexpr auto f_maxPopulation{std::numeric_limits<std::uint64_t>::max()};
+constexpr std::size_t f_maxNumber{std::size_t{1} << 48};
+constexpr std::size_t f_progressInterval{std::size_t{1} << 20};
+constexpr HashLife::NodeId f_noNode{0};
+
+// Line oriented reader that keeps the position of every character, so errors
+// can point at it.
+class Parser {
+public:
+  Parser(std::string_view text, HashLife &pattern,
+         const rle::ProgressCallback &progress)
+      : m_text{text}, m_pattern{pattern}, m_progress{progress},
+        m_position{0}, m_line{1}, m_lineStart{0},
+        m_nextReport{f_progressInterval}, m_nodes{f_noNode}, m_rule{} {}
+
+  std::optional<Rule> parse() {
+    if (m_text.substr(0, std::string_view{f_formatTag}.size()) !=
+        f_formatTag) {
+      fail("expected the [M2] macrocell tag");
+    }
+    skipLine();
+    while (!isAtEnd()) {
+      if (m_position >= m_nextReport) {
+        reportProgress();
+      }
+      auto symbol{m_text[m_position]};
+      if (symbol == f_commentSymbol) {
+        parseComment();
+      } else if (symbol == f_deadCellSymbol || symbol == f_aliveCellSymbol ||
+                 symbol == f_endOfRowSymbol) {
+        m_nodes.push_back(parseLeaf());
+      } else if (isDigit(symbol)) {
+        m_nodes.push_back(parseNode());
+      } else if (!isBlank(symbol)) {
+        fail(std::string{"unexpected '"} + symbol + "'");
+      }
+      skipLine();
+    }
+    if (m_nodes.size() == 1) {
+      fail("no nodes");
+    }
+    auto root{m_nodes.back()};
+    auto half{std::int64_t{1} << (m_pattern.level(root) - 1)};
+    m_pattern.setRoot(root, -half, -half);
+    if (m_rule) {
+      m_pattern.setRule(m_rule.value());
+    }
+    return m_rule;
+  }
+
+private:
+  static bool isDigit(char c) { return c >= '0' && c <= '9'; }
+
+  static bool isBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == f_endOfLine;
+  }
+
+  bool isAtEnd() const { return m_position == m_text.size(); }
+
+  char peek() const { return isAtEnd() ? '\0' : m_text[m_position]; }
+
+  [[noreturn]] void fail(const std::string &message) const {
+    throw rle::ParseError{message, m_line, m_position - m_lineStart + 1};
+  }
+
+  void reportProgress() {
+    m_nextReport = m_position + f_progressInterval;
+    auto fraction{static_cast<float>(m_position) /
+                  static_cast<float>(m_text.size())};
+    if (m_progress && !m_progress(fraction)) {
+      throw rle::Cancelled{};
+    }
+  }
+
+  void skipLine() {
+    while (!isAtEnd() && m_text[m_position] != f_endOfLine) {
+      m_position++;
+    }
+    if (!isAtEnd()) {
+      m_position++;
+      m_line++;
+      m_lineStart = m_position;
+    }
+  }
+
+  void skipSpaces() {
+    while (peek() == ' ' || peek() == '\t') {
+      m_position++;
+    }
+  }
+
+  void parseComment() {
+    m_position++;
+    if (peek() != f_ruleTag) {
+      return;
+    }
+    m_position++;
+    skipSpaces();
+    auto end{m_text.find_first_of(" \t\r\n", m_position)};
+    auto rule{m_text.substr(m_position, end - m_position)};
+    m_rule = rle::parseRule(std::string{rule});
+    if (!m_rule) {
+      fail("unsupported rule");
+    }
+    m_position += rule.size();
+  }
+
+  // An 8x8 leaf, one row per '$'; dead cells and rows at the end are left out.
+  HashLife::NodeId parseLeaf() {
+    std::uint64_t cells{0};
+    std::size_t col{0};
+    std::size_t row{0};
+    for (auto symbol{peek()}; !isBlank(symbol) && !isAtEnd();
+         symbol = peek()) {
+      if (symbol == f_endOfRowSymbol) {
+        row++;
+        col = 0;
+      } else if (symbol == f_deadCellSymbol || symbol == f_aliveCellSymbol) {
+        if (row >= f_leafSize || col >= f_leafSize) {
+          fail("leaf larger than 8x8");
+        }
+        if (symbol == f_aliveCellSymbol) {
+          cells |= std::uint64_t{1} << (row * f_leafSize + col);
+        }
+        col++;
+      } else {
+        fail(std::string{"unexpected '"} + symbol + "' in leaf");
+      }
+      m_position++;
+    }
+    return buildLeaf(cells, f_leafLevel, 0, 0);
+  }
+
+  HashLife::NodeId buildLeaf(std::uint64_t cells, std::size_t level,
+                             std::size_t col, std::size_t row) {
+    if (level == 0) {
+      return m_pattern.cell((cells >> (row * f_leafSize + col)) & 1);
+    }
+    auto half{std::size_t{1} << (level - 1)};
+    return m_pattern.join(buildLeaf(cells, level - 1, col, row),
+                          buildLeaf(cells, level - 1, col + half, row),
+                          buildLeaf(cells, level - 1, col, row + half),
+                          buildLeaf(cells, level - 1, col + half, row + half));
+  }
+
+  std::size_t parseNumber() {
+    skipSpaces();
+    if (!isDigit(peek())) {
+      fail("expected a number");
+    }
+    std::size_t number{0};
+    while (isDigit(peek())) {
+      if (number > f_maxNumber) {
+        fail("number too large");
+      }
+      number = number * 10 + static_cast<std::size_t>(peek() - '0');
+      m_position++;
+    }
+    return number;
+  }
+
+  // A level followed by the line numbers of its nw, ne, sw and se children,
+  // where 0 stands for an empty child.
+  HashLife::NodeId parseNode() {
+    auto level{parseNumber()};
+    if (level <= f_leafLevel || level > f_maxLevel) {
+      fail("unsupported node level");
+    }
+    HashLife::NodeId children[4];
+    std::uint64_t population{0};
+    for (auto &child : children) {
+      auto index{parseNumber()};
+      if (index >= m_nodes.size()) {
+        fail("reference to a later node");
+      }
+      child = index == 0 ? m_pattern.emptyNode(level - 1) : m_nodes[index];
+      if (m_pattern.level(child) != level - 1) {
+        fail("child of the wrong level");
+      }
+      if (m_pattern.population(child) > f_maxPopulation - population) {
+        fail("too many cells");
+      }
+      population += m_pattern.population(child);
+    }
+    return m_pattern.join(children[0], children[1], children[2], children[3]);
+  }
+
+  std::string_view m_text;
+  HashLife &m_pattern;
+  const rle::ProgressCallback &m_progress;
+  std::size_t m_position;
+  std::size_t m_line;
+  std::size_t m_lineStart;
+  std::size_t m_nextReport;
+  std::vector<HashLife::NodeId> m_nodes;
+  std::optional<Rule> m_rule;
+};
+
+// Numbers the distinct non-empty nodes in the order they are written, so
+// every child is written before its parent.
+class Writer {
+public:
+  Writer(std::ostream &stream, const HashLife &pattern)
+      : m_stream{stream}, m_pattern{pattern}, m_lines{}, m_lineCount{0} {}
+
+  std::size_t write(HashLife::NodeId id) {
+    if (m_pattern.population(id) == 0) {
+      return 0;
+    }
+    auto found{m_lines.find(id)};
+    if (found != m_lines.end()) {
+      return found->second;
+    }
+    auto level{m_pattern.level(id)};
+    if (level == f_leafLevel) {
+      writeLeaf(id);
+    } else {
+      auto [nw, ne, sw, se]{m_pattern.quadrants(id)};
+      auto nwLine{write(nw)};
+      auto neLine{write(ne)};
+      auto swLine{write(sw)};
+      auto seLine{write(se)};
+      m_stream << level << ' ' << nwLine << ' ' << neLine << ' ' << swLine
+               << ' ' << seLine << f_endOfLine;
+    }
+    m_lines.emplace(id, ++m_lineCount);
+    return m_lineCount;
+  }
+
+private:
+  void writeLeaf(HashLife::NodeId id) {
+    std::uint64_t cells{0};
+    collectLeaf(id, f_leafLevel, 0, 0, cells);
+    std::string text;
+    std::size_t emptyRows{0};
+    for (std::size_t row = 0; row < f_leafSize; row++) {
+      auto rowCells{(cells >> (row * f_leafSize)) & 0xff};
+      if (rowCells == 0) {
+        emptyRows++;
+        continue;
+      }
+      text.append(emptyRows, f_endOfRowSymbol);
+      emptyRows = 0;
+      for (; rowCells != 0; rowCells >>= 1) {
+        text.push_back((rowCells & 1) ? f_aliveCellSymbol : f_deadCellSymbol);
+      }
+      text.push_back(f_endOfRowSymbol);
+    }
+    m_stream << text << f_endOfLine;
+  }
+
+  void collectLeaf(HashLife::NodeId id, std::size_t level, std::size_t col,
+                   std::size_t row, std::uint64_t &cells) const {
+    if (m_pattern.population(id) == 0) {
+      return;
+    }
+    if (level == 0) {
+      cells |= std::uint64_t{1} << (row * f_leafSize + col);
+      return;
+    }
+    auto half{std::size_t{1} << (level - 1)};
+    auto [nw, ne, sw, se]{m_pattern.quadrants(id)};
+    collectLeaf(nw, level - 1, col, row, cells);
+    collectLeaf(ne, level - 1, col + half, row, cells);
+    collectLeaf(sw, level - 1, col, row + half, cells);
+    collectLeaf(se, level - 1, col + half, row + half, cells);
+  }
+
+  std::ostream &m_stream;
+  const HashLife &m_pattern;
+  std::unordered_map<HashLife::NodeId, std::size_t> m_lines;
+  std::size_t m_lineCount;
+};
+} // namespace
+
+namespace mc {
+bool isMacrocellFile(const std::filesystem::path &path) {
+  return path.extension().string() == f_macrocellFileExtension;
+}
+
+std::optional<Rule> parsePattern(std::string_view text, HashLife &pattern,
+                                 const rle::ProgressCallback &progress) {
+  return Parser{text, pattern, progress}.parse();
+}
+
+std::optional<Rule> loadPatternFile(const std::filesystem::path &path,
+                                    HashLife &pattern,
+                                    const rle::ProgressCallback &progress) {
+  std::ifstream istrm{path, std::ios::binary};
+  if (!istrm) {
+    throw std::runtime_error{"cannot open " + path.string()};
+  }
+  std::string text(std::filesystem::file_size(path), '\0');
+  istrm.read(text.data(), static_cast<std::streamsize>(text.size()));
+  text.resize(static_cast<std::size_t>(istrm.gcount()));
+  return parsePattern(text, pattern, progress);
+}
+
+// An empty pattern is written as a single empty leaf, since the file has to
+// end with the root.
+void writePattern(std::ostream &stream, const HashLife &pattern, Rule rule) {
+  stream << f_formatTag << ' ' << f_writerName << f_endOfLine
+         << f_commentSymbol << f_ruleTag << ' ' << rle::toString(rule)
+         << f_endOfLine;
+  if (pattern.population() == 0) {
+    stream << f_endOfRowSymbol << f_endOfLine;
+    return;
+  }
+  Writer{stream, pattern}.write(pattern.root());
+}
+
+void savePatternFile(const std::filesystem::path &path,
+                     const HashLife &pattern, Rule rule) {
+  std::ofstream ostrm{path};
+  writePattern(ostrm, pattern, rule);
+  if (!ostrm.flush()) {
+    throw std::runtime_error{"cannot write " + path.string()};
+  }
+}
+} // namespace mc
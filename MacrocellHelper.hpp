@@ -0,0 +1,30 @@
+#ifndef GAME_OF_LIFE_MACROCELL_HELPER_HPP
+#define GAME_OF_LIFE_MACROCELL_HELPER_HPP
+
+#include <filesystem>
+#include <optional>
+#include <ostream>
+#include <string_view>
+
+#include "HashLife.hpp"
+#include "RleHelper.hpp"
+#include "Rule.hpp"
+
+// Golly's macrocell format: every distinct quadtree node is written once, as
+// an 8x8 leaf or as a level followed by the line numbers of its four
+// children, so files grow with the complexity of a pattern rather than with
+// its area. Patterns are read straight into a HashLife engine and written out
+// of one.
+namespace mc {
+bool isMacrocellFile(const std::filesystem::path &path);
+std::optional<Rule> parsePattern(std::string_view text, HashLife &pattern,
+                                 const rle::ProgressCallback &progress = {});
+std::optional<Rule>
+loadPatternFile(const std::filesystem::path &path, HashLife &pattern,
+                const rle::ProgressCallback &progress = {});
+void writePattern(std::ostream &stream, const HashLife &pattern, Rule rule);
+void savePatternFile(const std::filesystem::path &path,
+                     const HashLife &pattern, Rule rule);
+} // namespace mc
+
+#endif
@@ -1,8 +1,11 @@
-#include <future>
-#include <thread>
+#include <cstring>
+#include <iostream>
 
 #include "Controller.hpp"
 #include "Model.hpp"
+#include "PatternLoader.hpp"
+#include "Profiler.hpp"
+#include "Simulation.hpp"
 #include "View.hpp"
 
 namespace {
@@ -10,32 +13,46 @@ constexpr auto f_windowTitle{"Game Of Life"};
 constexpr auto f_windowStyle{sf::Style::Fullscreen};
 constexpr auto f_modelMaxWidth{960};
 constexpr auto f_modelMaxHeight{515};
-constexpr auto f_defaultModelUpdatePeriod{std::chrono::milliseconds{100}};
+constexpr std::size_t f_historyMemoryLimit{64 << 20};
 } // namespace
 
-int main() {
+int main(int argc, char **argv) {
+  const char *tracePath{nullptr};
+#ifdef GAME_OF_LIFE_PROFILER
+  if (argc == 3 && std::strcmp(argv[1], "--trace") == 0) {
+    tracePath = argv[2];
+    Profiler::instance().startTrace();
+  } else if (argc != 1) {
+    std::cerr << "Usage: " << argv[0] << " [--trace PATH]\n";
+    return 1;
+  }
+#else
+  // Without the profiler there are no timed scopes to trace.
+  if (argc != 1) {
+    std::cerr << "Usage: " << argv[0] << "\n";
+    return 1;
+  }
+#endif
   sf::RenderWindow window{sf::VideoMode::getDesktopMode(), f_windowTitle,
                           f_windowStyle};
   window.setVerticalSyncEnabled(true);
   Model model{f_modelMaxWidth, f_modelMaxHeight};
-  View view{window, model};
-  Controller controller{view, model};
-  std::future<void> scheduler;
-  auto isModelScheduled{true};
+  model.setHistoryMemoryLimit(f_historyMemoryLimit);
+  PatternLoader patternLoader{model};
+  Simulation simulation{model};
+  View view{window, simulation, patternLoader};
+  Controller controller{view, simulation, patternLoader};
   while (window.isOpen()) {
     sf::Event event;
     while (window.pollEvent(event)) {
       controller.onEvent(event);
     }
-    if (model.status() == Model::Status::Running && isModelScheduled) {
-      scheduler = std::async([&isModelScheduled, &model]() {
-        isModelScheduled = false;
-        std::this_thread::sleep_for(f_defaultModelUpdatePeriod / model.speed());
-        isModelScheduled = true;
-      });
-      model.update();
-    }
+    controller.update();
     view.update();
   }
+  if (tracePath != nullptr && !Profiler::instance().writeTrace(tracePath)) {
+    std::cerr << "Cannot write trace to " << tracePath << "\n";
+    return 1;
+  }
   return 0;
 }
@@ -1,9 +1,15 @@
 #include "Model.hpp"
 
 #include <algorithm>
+#include <bitset>
+#include <cmath>
 #include <random>
+#include <stdexcept>
+#include <thread>
 
 #include "Cell.hpp"
+#include "Kernel.hpp"
+#include "Profiler.hpp"
 
 namespace {
 constexpr size_t f_defaultSpeed{10};
@@ -15,31 +21,148 @@ constexpr size_t f_minRuleValue{0};
 constexpr size_t f_maxRuleValue{8};
 constexpr std::initializer_list<size_t> f_conwaysBirthRule{3};
 constexpr std::initializer_list<size_t> f_conwaysSurvivalRule{2, 3};
+// Tasks a generation is split into per thread.
+constexpr size_t f_tasksPerThread{4};
+// Longest period that is recognised as a cycle.
+constexpr size_t f_maxCyclePeriod{64};
+
+constexpr std::uint64_t f_randomGamma{0x9e3779b97f4a7c15};
+// Precision of the probability that a generated cell is alive.
+constexpr size_t f_densityBits{16};
+
+// SplitMix64. Its state is a counter, so a stream can be entered at any
+// offset, and rows filled in parallel come out as if filled in order.
+class RandomWords {
+public:
+  RandomWords(std::uint64_t seed, std::uint64_t offset)
+      : m_state{seed + offset * f_randomGamma} {}
+
+  std::uint64_t operator()() {
+    auto word{m_state += f_randomGamma};
+    word = (word ^ (word >> 30)) * 0xbf58476d1ce4e5b9;
+    word = (word ^ (word >> 27)) * 0x94d049bb133111eb;
+    return word ^ (word >> 31);
+  }
+
+private:
+  std::uint64_t m_state;
+};
+
+// Sets every bit with probability fraction / 2^draws, where fraction is odd,
+// by folding in one random word per bit of the fraction from the lowest up:
+// ORing raises the probability halfway to one and ANDing halves it.
+Grid::Word randomWord(RandomWords &random, std::uint64_t fraction,
+                      size_t draws) {
+  if (draws == 0) {
+    return fraction == 0 ? Grid::Word{0} : ~Grid::Word{0};
+  }
+  Grid::Word word{0};
+  for (size_t draw = 0; draw < draws; draw++, fraction >>= 1) {
+    word = (fraction & 1) ? (word | random()) : (word & random());
+  }
+  return word;
+}
+// With B0 every cell far from the live ones is born, which the sparse plane,
+// storing only the chunks around live cells, cannot represent.
+inline void checkUnboundedRule(Rule rule, bool isUnbounded) {
+  if (isUnbounded && (rule.birthMask & 1) != 0) {
+    throw std::invalid_argument{"rules with B0 cannot run unbounded"};
+  }
+}
+
+inline auto defaultThreadCount() {
+  return std::max<size_t>(1, std::thread::hardware_concurrency());
+}
+
+inline auto toRuleMask(const std::set<size_t> &rule) {
+  std::uint16_t mask{0};
+  for (auto val : rule) {
+    mask = static_cast<std::uint16_t>(mask | (1u << val));
+  }
+  return mask;
+}
 
-inline auto generateRandomValue(size_t min, size_t max) {
-  std::random_device rd;
-  std::mt19937 gen{rd()};
-  std::uniform_int_distribution<size_t> distr{min, max};
-  return distr(gen);
-}
-inline auto generateCells(size_t width, size_t height) {
-  std::vector<Cell> cells;
-  for (size_t row = 0; row < height; row++) {
-    for (size_t col = 0; col < width; col++) {
-      cells.push_back({col, row, Cell::Status::Empty});
+inline auto toRuleSet(std::uint16_t mask) {
+  std::set<size_t> rule;
+  for (auto val = f_minRuleValue; val <= f_maxRuleValue; val++) {
+    if ((mask >> val) & 1) {
+      rule.insert(val);
+    }
+  }
+  return rule;
+}
+// Calls `visit(col, row)` for every alive cell, in row-major order, skipping
+// empty words.
+template <typename Visitor>
+void forEachAliveCell(const Grid &grid, Visitor visit) {
+  for (size_t row = 0; row < grid.height(); row++) {
+    const auto *words{grid.row(row)};
+    for (size_t index = 0; index < grid.wordsPerRow(); index++) {
+      for (auto word{words[index]}; word != 0; word &= word - 1) {
+        auto lowestBit{word & (~word + 1)};
+        auto bit{std::bitset<Grid::bitsPerWord>{lowestBit - 1}.count()};
+        visit(index * Grid::bitsPerWord + bit, row);
+      }
     }
   }
-  return cells;
 }
 } // namespace
 
 Model::Model(size_t width, size_t height)
     : m_width{width}, m_height{height}, m_status{Status::Stopped},
       m_speed{f_defaultSpeed}, m_generation{}, m_population{},
-      m_initialPattern{}, m_survivalRule{f_conwaysSurvivalRule},
+      m_initialPattern{width, height}, m_survivalRule{f_conwaysSurvivalRule},
       m_birthRule{f_conwaysBirthRule},
-      m_cellStatus{m_width, {m_height, Cell::Status::Empty}},
-      m_updatedCellStatus{m_cellStatus}, m_cells{generateCells(width, height)} {
+      m_rule{toRuleMask(m_birthRule), toRuleMask(m_survivalRule)},
+      m_kernel{kernel::select(m_rule)}, m_cells{width, height},
+      m_nextCells{width, height}, m_visitedCells{width, height},
+      m_tiles{width, height}, m_tileRowSplits{1}, m_stepChanges{},
+      m_hashLife{}, m_history{}, m_hash{0}, m_recentHashes{}, m_cycle{},
+      m_sparseCells{}, m_initialOuterCells{}, m_isUnbounded{false},
+      m_populationSeed{0}, m_threadPool{defaultThreadCount()} {
+  splitTileRows();
+}
+
+Model::CellIterator::CellIterator(const Model &model, std::size_t index)
+    : m_model{&model}, m_index{index} {}
+
+Cell Model::CellIterator::operator*() const {
+  auto col{m_index % m_model->m_width};
+  auto row{m_index / m_model->m_width};
+  return {col, row, m_model->cellStatus(col, row)};
+}
+
+Model::CellIterator &Model::CellIterator::operator++() {
+  m_index++;
+  return *this;
+}
+
+Model::CellIterator Model::CellIterator::operator++(int) {
+  auto it{*this};
+  m_index++;
+  return it;
+}
+
+bool Model::CellIterator::operator==(const CellIterator &other) const {
+  return m_index == other.m_index;
+}
+
+bool Model::CellIterator::operator!=(const CellIterator &other) const {
+  return m_index != other.m_index;
+}
+
+Model::Cells::Cells(const Model &model) : m_model{model} {}
+
+Model::CellIterator Model::Cells::begin() const { return {m_model, 0}; }
+
+Model::CellIterator Model::Cells::end() const { return {m_model, size()}; }
+
+Model::CellIterator Model::Cells::cbegin() const { return begin(); }
+
+Model::CellIterator Model::Cells::cend() const { return end(); }
+
+size_t Model::Cells::size() const {
+  return m_model.m_width * m_model.m_height;
 }
 
 Model::Status Model::status() const { return m_status; }
@@ -58,20 +181,60 @@ size_t Model::generation() const { return m_generation; }
 
 size_t Model::population() const { return m_population; }
 
-#include <iostream>
 std::optional<Cell> Model::cellAt(std::size_t col, std::size_t row) const {
-  auto index{toCellIndex(col, row)};
-  std::cout << int(m_cells.at(index).status) << std::endl;
-  return (index < m_cells.size()) ? m_cells.at(index) : std::optional<Cell>{};
+  if (col >= m_width || row >= m_height) {
+    return {};
+  }
+  return Cell{col, row, cellStatus(col, row)};
+}
+
+const Grid &Model::initialPattern() const { return m_initialPattern; }
+
+const Grid &Model::aliveCells() const { return m_cells; }
+
+void Model::storeCells(HashLife &cells) const {
+  if (m_isUnbounded) {
+    cells.load(m_sparseCells);
+  } else {
+    cells.load(m_cells);
+  }
 }
 
-const std::set<Cell> &Model::initialPattern() const { return m_initialPattern; }
+const Grid &Model::visitedCells() const { return m_visitedCells; }
 
 const std::set<size_t> &Model::survivalRule() const { return m_survivalRule; }
 
 const std::set<size_t> &Model::birthRule() const { return m_birthRule; }
 
-const std::vector<Cell> &Model::cells() const { return m_cells; }
+Rule Model::rule() const { return m_rule; }
+
+size_t Model::memoryUsage() const {
+  return m_cells.memoryUsage() + m_nextCells.memoryUsage() +
+         m_visitedCells.memoryUsage() + m_sparseCells.memoryUsage() +
+         m_history.memoryUsage();
+}
+
+size_t Model::threadCount() const { return m_threadPool.size(); }
+
+size_t Model::tileCount() const { return m_tiles.size(); }
+
+size_t Model::activeTileCount() const { return m_tiles.activeCount(); }
+
+const TileMap &Model::tiles() const { return m_tiles; }
+
+bool Model::isUnbounded() const { return m_isUnbounded; }
+
+size_t Model::historyMemoryUsage() const { return m_history.memoryUsage(); }
+
+std::optional<Model::Cycle> Model::cycle() const { return m_cycle; }
+
+size_t Model::rewindableGenerations() const {
+  return m_history.empty() ? 0 : m_generation - m_history.oldestGeneration();
+}
+
+std::uint64_t Model::populationSeed() const { return m_populationSeed; }
+
+Model::Cells Model::cells() const { return Cells{*this}; }
 
 void Model::run() {
   switch (m_status) {
@@ -89,23 +252,30 @@ void Model::run() {
 void Model::pause() { m_status = Model::Status::Paused; }
 
 void Model::reset() {
+  m_history.clear();
   m_generation = 0;
-  m_population = 0;
-  std::for_each(m_cells.begin(), m_cells.end(),
-                [](auto &c) { c.status = Cell::Status::Empty; });
-  for (const auto &cell : m_initialPattern) {
-    m_cells.at(toCellIndex(cell.col, cell.row)).status = Cell::Status::Alive;
-    m_population++;
+  m_cells = m_initialPattern;
+  m_visitedCells = m_initialPattern;
+  m_tiles.markAllChanged();
+  m_population = m_cells.population();
+  if (m_isUnbounded) {
+    loadSparseCells();
   }
+  resetCycleDetection();
   updateStatus();
 }
 
 void Model::clear() {
+  m_history.clear();
   m_generation = 0;
   m_population = 0;
-  std::for_each(m_cells.begin(), m_cells.end(),
-                [](auto &c) { c.status = Cell::Status::Empty; });
+  m_cells.clear();
+  m_visitedCells.clear();
+  m_sparseCells.clear();
+  m_tiles.markAllChanged();
   m_initialPattern.clear();
+  m_initialOuterCells.clear();
+  resetCycleDetection();
   updateStatus();
 }
 
@@ -114,49 +284,208 @@ void Model::speedUp() { m_speed = std::min(f_maxSpeed, m_speed + 1); }
 void Model::slowDown() { m_speed = std::max(f_minSpeed, m_speed - 1); }
 
 void Model::insertCell(const Cell &cell) {
-  m_cells.at(toCellIndex(cell.col, cell.row)).status = Cell::Status::Alive;
-  m_initialPattern.insert(cell);
-  m_population++;
+  m_history.clear();
+  m_recentHashes.clear();
+  m_cycle.reset();
+  if (!m_cells.at(cell.col, cell.row)) {
+    auto word{cell.col / Grid::bitsPerWord};
+    auto index{cell.row * m_cells.wordsPerRow() + word};
+    auto before{m_cells.row(cell.row)[word]};
+    m_cells.set(cell.col, cell.row, true);
+    m_hash ^= Grid::hashWord(index, before) ^
+              Grid::hashWord(index, m_cells.row(cell.row)[word]);
+    m_population++;
+  }
+  if (m_isUnbounded) {
+    m_sparseCells.set(static_cast<SparseLife::Coord>(cell.col),
+                      static_cast<SparseLife::Coord>(cell.row), true);
+  }
+  m_visitedCells.set(cell.col, cell.row, true);
+  m_tiles.markCellChanged(cell.col, cell.row);
+  m_initialPattern.set(cell.col, cell.row, true);
   updateStatus();
 }
 
 void Model::removeCell(const Cell &cell) {
-  m_cells.at(toCellIndex(cell.col, cell.row)).status = Cell::Status::Empty;
-  m_initialPattern.erase(cell);
-  m_population--;
+  m_history.clear();
+  m_recentHashes.clear();
+  m_cycle.reset();
+  if (m_cells.at(cell.col, cell.row)) {
+    auto word{cell.col / Grid::bitsPerWord};
+    auto index{cell.row * m_cells.wordsPerRow() + word};
+    auto before{m_cells.row(cell.row)[word]};
+    m_cells.set(cell.col, cell.row, false);
+    m_hash ^= Grid::hashWord(index, before) ^
+              Grid::hashWord(index, m_cells.row(cell.row)[word]);
+    m_population--;
+  }
+  if (m_isUnbounded) {
+    m_sparseCells.set(static_cast<SparseLife::Coord>(cell.col),
+                      static_cast<SparseLife::Coord>(cell.row), false);
+  }
+  m_visitedCells.set(cell.col, cell.row, false);
+  m_tiles.markCellChanged(cell.col, cell.row);
+  m_initialPattern.set(cell.col, cell.row, false);
   updateStatus();
 }
 
-void Model::insertPattern(const std::set<Cell> &pattern) {
-  auto mostLeftElement{std::min_element(
-      pattern.cbegin(), pattern.cend(),
-      [](const auto &a, const auto &b) { return a.col < b.col; })};
-  auto mostTopElement{std::min_element(
-      pattern.cbegin(), pattern.cend(),
-      [](const auto &a, const auto &b) { return a.row < b.row; })};
-  auto mostRightElement{std::max_element(
-      pattern.cbegin(), pattern.cend(),
-      [](const auto &a, const auto &b) { return a.col < b.col; })};
-  auto mostBottomElement{std::max_element(
-      pattern.cbegin(), pattern.cend(),
-      [](const auto &a, const auto &b) { return a.row < b.row; })};
-  auto width{mostRightElement->col - mostLeftElement->col};
-  auto height{mostBottomElement->row - mostTopElement->row};
-  for (auto cell : pattern) {
-    cell.col += (m_width - width) / 2;
-    cell.row += (m_height - height) / 2;
-    m_initialPattern.insert(cell);
-    m_cells.at(toCellIndex(cell.col, cell.row)).status = Cell::Status::Alive;
-    m_population++;
-    updateStatus();
+void Model::insertPattern(const Grid &pattern) {
+  insertPattern(stagePattern(pattern, m_isUnbounded));
+}
+
+// Only reads the grid size, so it may run on another thread while the model
+// keeps evolving.
+Model::StagedPattern Model::stagePattern(const Grid &pattern,
+                                         bool keepOuterCells) const {
+  StagedPattern staged{Grid{m_width, m_height}, {}, {}};
+  auto mostLeftCol{pattern.width()};
+  auto mostRightCol{std::size_t{0}};
+  auto mostTopRow{pattern.height()};
+  auto mostBottomRow{std::size_t{0}};
+  forEachAliveCell(pattern, [&](auto col, auto row) {
+    mostLeftCol = std::min(mostLeftCol, col);
+    mostRightCol = std::max(mostRightCol, col);
+    mostTopRow = std::min(mostTopRow, row);
+    mostBottomRow = row;
+  });
+  if (mostTopRow > mostBottomRow) {
+    return staged;
+  }
+  using Coord = SparseLife::Coord;
+  auto width{static_cast<Coord>(mostRightCol - mostLeftCol)};
+  auto height{static_cast<Coord>(mostBottomRow - mostTopRow)};
+  auto colOffset{(static_cast<Coord>(m_width) - width) / 2 -
+                 static_cast<Coord>(mostLeftCol)};
+  auto rowOffset{(static_cast<Coord>(m_height) - height) / 2 -
+                 static_cast<Coord>(mostTopRow)};
+  forEachAliveCell(pattern, [&](auto patternCol, auto patternRow) {
+    auto col{static_cast<Coord>(patternCol) + colOffset};
+    auto row{static_cast<Coord>(patternRow) + rowOffset};
+    if (keepOuterCells) {
+      staged.plane.set(col, row, true);
+    }
+    if (col < 0 || row < 0 || col >= static_cast<Coord>(m_width) ||
+        row >= static_cast<Coord>(m_height)) {
+      if (keepOuterCells) {
+        staged.outerCells.emplace_back(col, row);
+      }
+      return;
+    }
+    staged.cells.set(static_cast<size_t>(col), static_cast<size_t>(row), true);
+  });
+  return staged;
+}
+
+// Only the cells that land on the grid or, when they are kept, on the sparse
+// plane are ever expanded out of the quadtree.
+Model::StagedPattern Model::stagePattern(const HashLife &pattern,
+                                         bool keepOuterCells) const {
+  StagedPattern staged{Grid{m_width, m_height}, {}, {}};
+  auto bounds{pattern.bounds()};
+  if (!bounds) {
+    return staged;
+  }
+  using Coord = SparseLife::Coord;
+  auto width{bounds->right - bounds->left};
+  auto height{bounds->bottom - bounds->top};
+  auto colOffset{(static_cast<Coord>(m_width) - width) / 2 - bounds->left};
+  auto rowOffset{(static_cast<Coord>(m_height) - height) / 2 - bounds->top};
+  pattern.store(staged.cells, colOffset, rowOffset);
+  if (!keepOuterCells) {
+    return staged;
+  }
+  pattern.store(staged.plane, colOffset, rowOffset);
+  staged.plane.forEachChunk([&](auto chunkCol, auto chunkRow, auto *words) {
+    for (std::size_t row = 0; row < SparseLife::chunkSize; row++) {
+      for (auto word{words[row]}; word != 0; word &= word - 1) {
+        auto lowestBit{word & (~word + 1)};
+        auto bit{std::bitset<Grid::bitsPerWord>{lowestBit - 1}.count()};
+        auto col{chunkCol + static_cast<Coord>(bit)};
+        auto cellRow{chunkRow + static_cast<Coord>(row)};
+        if (col < 0 || cellRow < 0 || col >= static_cast<Coord>(m_width) ||
+            cellRow >= static_cast<Coord>(m_height)) {
+          staged.outerCells.emplace_back(col, cellRow);
+        }
+      }
+    }
+  });
+  return staged;
+}
+
+// Merges a staged pattern a word at a time, and takes over its sparse plane
+// when there is nothing to merge it with, so it is cheap enough to run between
+// two frames.
+void Model::insertPattern(StagedPattern &&pattern) {
+  m_history.clear();
+  for (size_t row = 0; row < m_height; row++) {
+    const auto *words{pattern.cells.row(row)};
+    auto *initialWords{m_initialPattern.row(row)};
+    auto *cellWords{m_cells.row(row)};
+    auto *visitedWords{m_visitedCells.row(row)};
+    for (size_t word = 0; word < m_cells.wordsPerRow(); word++) {
+      initialWords[word] |= words[word];
+      cellWords[word] |= words[word];
+      visitedWords[word] |= words[word];
+    }
+  }
+  m_tiles.markAllChanged();
+  if (m_isUnbounded && pattern.plane.population() > 0 &&
+      m_sparseCells.population() == 0) {
+    m_sparseCells = std::move(pattern.plane);
+  } else if (m_isUnbounded) {
+    forEachAliveCell(pattern.cells, [this](auto col, auto row) {
+      m_sparseCells.set(static_cast<SparseLife::Coord>(col),
+                        static_cast<SparseLife::Coord>(row), true);
+    });
+    for (const auto &[col, row] : pattern.outerCells) {
+      m_sparseCells.set(col, row, true);
+    }
+  }
+  if (m_isUnbounded && m_initialOuterCells.empty()) {
+    m_initialOuterCells = std::move(pattern.outerCells);
+  } else if (m_isUnbounded) {
+    m_initialOuterCells.insert(m_initialOuterCells.end(),
+                               pattern.outerCells.cbegin(),
+                               pattern.outerCells.cend());
   }
+  m_population = m_isUnbounded
+                     ? static_cast<size_t>(m_sparseCells.population())
+                     : m_cells.population();
+  resetCycleDetection();
+  updateStatus();
+}
+
+// Resumes a saved simulation: the cells become both the current generation
+// and the pattern that reset returns to. They must match the model's size.
+void Model::restore(Grid &&cells, Rule rule, size_t generation) {
+  checkUnboundedRule(rule, m_isUnbounded);
+  m_history.clear();
+  m_cells = std::move(cells);
+  m_initialPattern = m_cells;
+  m_visitedCells = m_cells;
+  m_initialOuterCells.clear();
+  m_tiles.markAllChanged();
+  setRule(rule);
+  if (m_isUnbounded) {
+    m_sparseCells.clear();
+    loadSparseCells();
+  } else {
+    m_population = m_cells.population();
+  }
+  m_generation = generation;
+  resetCycleDetection();
+  updateStatus();
 }
 
 void Model::setBirthRule(const std::set<size_t> &rule) {
-  m_birthRule.clear();
+  std::set<size_t> birthRule;
   for (auto val : rule) {
-    m_birthRule.insert(std::max(std::min(val, f_maxRuleValue), f_minRuleValue));
+    birthRule.insert(std::max(std::min(val, f_maxRuleValue), f_minRuleValue));
   }
+  checkUnboundedRule({toRuleMask(birthRule), m_rule.survivalMask},
+                     m_isUnbounded);
+  m_birthRule = std::move(birthRule);
+  updateRule();
 }
 
 void Model::setSurvivalRule(const std::set<size_t> &rule) {
@@ -165,57 +494,219 @@ void Model::setSurvivalRule(const std::set<size_t> &rule) {
     m_survivalRule.insert(
         std::max(std::min(val, f_maxRuleValue), f_minRuleValue));
   }
+  updateRule();
 }
 
-void Model::generatePopulation(double density) {
-  auto population{static_cast<double>(m_width * m_height) * density};
-  for (size_t i = 0; i < static_cast<size_t>(population); i++) {
-    auto pos{generateRandomValue(0, m_width * m_height - 1)};
-    Cell cell{pos % m_width, pos / m_width};
-    insertCell(cell);
+void Model::setRule(Rule rule) {
+  checkUnboundedRule(rule, m_isUnbounded);
+  m_birthRule = toRuleSet(rule.birthMask);
+  m_survivalRule = toRuleSet(rule.survivalMask);
+  updateRule();
+}
+
+void Model::setThreadCount(size_t count) {
+  m_threadPool.resize(count);
+  splitTileRows();
+}
+
+void Model::setHashLifeMemoryLimit(size_t bytes) {
+  m_hashLife.setMemoryLimit(bytes);
+}
+
+// History is only recorded on the bounded grid, and a limit of zero, the
+// default, turns it off.
+void Model::setHistoryMemoryLimit(size_t bytes) {
+  m_history.setMemoryLimit(bytes);
+}
+
+// In unbounded mode the grid is a window onto a sparse plane, so patterns
+// keep evolving after they leave it. Switching back to the bounded grid drops
+// every cell outside the window. Rules with B0 are only run bounded.
+void Model::setUnbounded(bool isUnbounded) {
+  if (isUnbounded == m_isUnbounded) {
+    return;
+  }
+  checkUnboundedRule(m_rule, isUnbounded);
+  m_isUnbounded = isUnbounded;
+  m_history.clear();
+  resetCycleDetection();
+  if (m_isUnbounded) {
+    loadSparseCells();
+    return;
   }
+  m_sparseCells.clear();
+  m_initialOuterCells.clear();
+  m_tiles.markAllChanged();
+  m_population = m_cells.population();
   updateStatus();
 }
 
-std::size_t Model::toCellIndex(std::size_t col, std::size_t row) const {
-  return row * m_width + col;
+void Model::clearDirtyTiles() { m_tiles.clearDirty(); }
+
+void Model::generatePopulation(double density) {
+  std::random_device device;
+  generatePopulation(density,
+                     (std::uint64_t{device()} << 32) ^ std::uint64_t{device()});
+}
+
+// Adds a soup of exactly density times the grid size cells, the same for the
+// same seed whatever the thread count. Rows are filled a word at a time in
+// parallel, and the few cells the count is off by are then added or removed
+// at random.
+void Model::generatePopulation(double density, std::uint64_t seed) {
+  m_populationSeed = seed;
+  density = std::clamp(density, 0., 1.);
+  auto fraction{static_cast<std::uint64_t>(std::llround(
+      density * static_cast<double>(std::uint64_t{1} << f_densityBits)))};
+  auto draws{f_densityBits};
+  for (; draws > 0 && fraction % 2 == 0; draws--) {
+    fraction /= 2;
+  }
+  Grid soup{m_width, m_height};
+  auto wordsPerRow{soup.wordsPerRow()};
+  m_threadPool.parallelFor(m_height, [&](size_t row) {
+    RandomWords random{seed, row * wordsPerRow * draws};
+    auto *words{soup.row(row)};
+    for (size_t word = 0; word < wordsPerRow; word++) {
+      words[word] = randomWord(random, fraction, draws);
+    }
+    words[wordsPerRow - 1] &= soup.lastWordMask();
+  });
+  auto cellCount{m_width * m_height};
+  auto target{static_cast<size_t>(
+      std::llround(density * static_cast<double>(cellCount)))};
+  RandomWords random{seed, m_height * wordsPerRow * draws};
+  for (auto population{soup.population()}; population != target;) {
+    auto cell{random() % cellCount};
+    auto isAlive{population > target};
+    if (soup.at(cell % m_width, cell / m_width) == isAlive) {
+      soup.set(cell % m_width, cell / m_width, !isAlive);
+      population = isAlive ? population - 1 : population + 1;
+    }
+  }
+  insertPattern(StagedPattern{std::move(soup), {}, {}});
 }
 
 void Model::update() {
-  auto cells{m_cells};
-  auto population{0};
-  std::transform(m_cells.cbegin(), m_cells.cend(), cells.begin(),
-                 [this, &population](auto cell) {
-                   auto numberOfAliveNeighbours{0};
-                   for (auto col = cell.col - 1; col <= cell.col + 1; col++) {
-                     if (col >= m_width) {
-                       continue;
-                     }
-                     for (auto row = cell.row - 1; row <= cell.row + 1; row++) {
-                       if (row >= m_height ||
-                           (col == cell.col && row == cell.row)) {
-                         continue;
-                       }
-                       if (m_cells.at(toCellIndex(col, row)).status ==
-                           Cell::Status::Alive) {
-                         numberOfAliveNeighbours++;
-                       }
-                     }
-                   }
-                   if (cell.status == Cell::Status::Alive &&
-                       m_survivalRule.count(numberOfAliveNeighbours) == 0) {
-                     cell.status = Cell::Status::Dead;
-                   } else if (m_birthRule.count(numberOfAliveNeighbours) != 0) {
-                     cell.status = Cell::Status::Alive;
-                   }
-                   if (cell.status == Cell::Status::Alive) {
-                     population++;
-                   }
-                   return cell;
-                 });
-  m_cells = std::move(cells);
-  m_population = population;
+  PROFILE_SCOPE(Profiler::Stage::ModelUpdate);
+  if (m_isUnbounded) {
+    m_sparseCells.setRule(m_rule);
+    m_sparseCells.step();
+    storeSparseCells();
+    m_generation++;
+    return;
+  }
+  if (m_kernel.isa != kernel::isa()) {
+    m_kernel = kernel::select(m_rule);
+  }
+  if (m_recentHashes.empty()) {
+    m_recentHashes.emplace_back(m_hash, m_generation);
+  }
+  m_tiles.activate();
+  m_threadPool.parallelFor(m_stepChanges.size(), [&](size_t task) {
+    m_stepChanges[task] =
+        stepTask(m_cells, m_nextCells, m_visitedCells, m_tiles, task);
+  });
+  auto populationChange{std::ptrdiff_t{0}};
+  for (const auto &change : m_stepChanges) {
+    populationChange += change.population;
+    m_hash ^= change.hash;
+  }
+  m_population = static_cast<size_t>(
+      static_cast<std::ptrdiff_t>(m_population) + populationChange);
+  std::swap(m_cells, m_nextCells);
+  m_history.record(m_nextCells, m_generation, m_cells, m_generation + 1,
+                   &m_tiles);
   m_generation++;
+  detectCycle();
+}
+
+// HashLife evolves an unbounded plane, where cells beyond the edges of the
+// grid would keep interacting with the ones inside it. On the bounded grid a
+// jump is therefore only made when the live cells stay at least as many cells
+// away from every edge as generations are jumped: without B0 nothing spreads
+// faster than a cell per generation, so no cell is born outside the grid
+// before the last generation.
+bool Model::jump(std::size_t log2Generations) {
+  log2Generations = std::min(log2Generations, HashLife::maxLog2Generations);
+  if (m_rule.birthMask & 1) {
+    return false;
+  }
+  m_hashLife.setRule(m_rule);
+  if (!m_isUnbounded) {
+    m_hashLife.load(m_cells);
+    auto bounds{m_hashLife.bounds()};
+    auto margin{std::int64_t{1} << log2Generations};
+    auto width{static_cast<std::int64_t>(m_width)};
+    auto height{static_cast<std::int64_t>(m_height)};
+    if (bounds && (bounds->left < margin || bounds->top < margin ||
+                   bounds->right + margin >= width ||
+                   bounds->bottom + margin >= height)) {
+      return false;
+    }
+  }
+  if (m_isUnbounded) {
+    m_hashLife.load(m_sparseCells);
+    m_hashLife.advance(log2Generations);
+    m_sparseCells.clear();
+    m_hashLife.store(m_sparseCells);
+    storeSparseCells();
+  } else {
+    if (m_history.memoryLimit() > 0) {
+      m_nextCells = m_cells;
+    }
+    m_hashLife.advance(log2Generations);
+    m_cells.clear();
+    m_hashLife.store(m_cells);
+    markVisitedCells();
+    m_tiles.markAllChanged();
+    m_population = m_cells.population();
+    m_history.record(m_nextCells, m_generation, m_cells,
+                     m_generation + (size_t{1} << log2Generations));
+  }
+  m_generation += size_t{1} << log2Generations;
+  resetCycleDetection();
+  if (m_status == Status::ReadyToRun) {
+    m_status = Status::Paused;
+  }
+  return true;
+}
+
+// Advances a model that has settled into a cycle by the given number of
+// generations, only evolving the ones left over after whole periods. Returns
+// false, doing nothing, when no cycle has been detected.
+bool Model::fastForward(size_t generations) {
+  if (!m_cycle) {
+    return false;
+  }
+  auto remainder{generations % m_cycle->period};
+  for (size_t generation = 0; generation < remainder; generation++) {
+    update();
+  }
+  m_generation += generations - remainder;
+  return true;
+}
+
+// Steps back through the recorded history, re-simulating from the nearest
+// keyframe when the generations in between were evicted, and returns how
+// many generations were undone.
+size_t Model::rewind(size_t generations) {
+  if (m_history.empty()) {
+    return 0;
+  }
+  auto start{m_generation};
+  auto target{m_generation - std::min(generations, m_generation)};
+  m_generation = m_history.rewind(m_cells, m_generation, target);
+  m_tiles.markAllChanged();
+  m_population = m_cells.population();
+  resetCycleDetection();
+  while (m_generation < target) {
+    update();
+  }
+  if (m_status != Status::Running) {
+    m_status = m_population > 0 ? Status::Paused : Status::Stopped;
+  }
+  return start - m_generation;
 }
 
 void Model::updateStatus() {
@@ -224,4 +715,117 @@ void Model::updateStatus() {
   } else if (m_population == 0) {
     m_status = Status::Stopped;
   }
-}
\ No newline at end of file
+}
+
+void Model::updateRule() {
+  m_history.clear();
+  m_recentHashes.clear();
+  m_cycle.reset();
+  m_rule = {toRuleMask(m_birthRule), toRuleMask(m_survivalRule)};
+  m_kernel = kernel::select(m_rule);
+  m_tiles.markAllChanged();
+}
+
+void Model::loadSparseCells() {
+  m_sparseCells.load(m_cells);
+  for (const auto &[col, row] : m_initialOuterCells) {
+    m_sparseCells.set(col, row, true);
+  }
+  m_population = static_cast<size_t>(m_sparseCells.population());
+}
+
+void Model::storeSparseCells() {
+  m_cells.clear();
+  m_sparseCells.store(m_cells);
+  m_tiles.markAllChanged();
+  markVisitedCells();
+  m_population = static_cast<size_t>(m_sparseCells.population());
+}
+
+void Model::resetCycleDetection() {
+  m_hash = m_cells.hash();
+  m_recentHashes.clear();
+  m_cycle.reset();
+}
+
+// Looks the new state up among the recent ones. A running model pauses the
+// first time it settles into a cycle. Matching hashes are only taken for a
+// cycle once the cells are seen to repeat, so a collision cannot stop a
+// model that is still evolving.
+void Model::detectCycle() {
+  if (m_cycle) {
+    return;
+  }
+  for (const auto &[hash, generation] : m_recentHashes) {
+    if (hash == m_hash && repeatsAfter(m_generation - generation)) {
+      m_cycle = Cycle{m_generation - generation, generation};
+      if (m_status == Status::Running) {
+        m_status = Status::Paused;
+      }
+      return;
+    }
+  }
+  m_recentHashes.emplace_back(m_hash, m_generation);
+  if (m_recentHashes.size() > f_maxCyclePeriod) {
+    m_recentHashes.pop_front();
+  }
+}
+
+// Evolves copies of the grids the given number of generations and returns
+// whether they come back to the current cells. The previous generation is
+// copied along with them, as tiles that are not evolved keep it.
+bool Model::repeatsAfter(size_t generations) {
+  auto tiles{m_tiles};
+  auto cells{m_cells};
+  auto nextCells{m_nextCells};
+  Grid visitedCells{m_width, m_height};
+  for (size_t generation = 0; generation < generations; generation++) {
+    tiles.activate();
+    m_threadPool.parallelFor(m_stepChanges.size(), [&](size_t task) {
+      stepTask(cells, nextCells, visitedCells, tiles, task);
+    });
+    std::swap(cells, nextCells);
+  }
+  return std::equal(cells.words(), cells.words() + cells.wordCount(),
+                    m_cells.words());
+}
+
+// A grid of few tile rows, such as the default 515 rows high one, would
+// otherwise make fewer tasks than a generation needs to balance its uneven
+// tiles across the threads.
+void Model::splitTileRows() {
+  auto rows{std::max<size_t>(m_tiles.rows(), 1)};
+  auto columns{std::max<size_t>(m_tiles.columns(), 1)};
+  auto tasks{f_tasksPerThread * m_threadPool.size()};
+  m_tileRowSplits = std::clamp<size_t>((tasks + rows - 1) / rows, 1, columns);
+  m_stepChanges.assign(m_tiles.rows() * m_tileRowSplits, {0, 0});
+}
+
+// Steps one of the column ranges the tile rows are split into.
+kernel::StepChange Model::stepTask(const Grid &current, Grid &next,
+                                   Grid &visited, TileMap &tiles,
+                                   size_t task) const {
+  auto tileRow{task / m_tileRowSplits};
+  auto split{task % m_tileRowSplits};
+  auto columns{tiles.columns()};
+  return kernel::step(current, next, visited, tiles, tileRow,
+                      split * columns / m_tileRowSplits,
+                      (split + 1) * columns / m_tileRowSplits, m_kernel);
+}
+
+void Model::markVisitedCells() {
+  for (size_t row = 0; row < m_height; row++) {
+    const auto *cells{m_cells.row(row)};
+    auto *visitedCells{m_visitedCells.row(row)};
+    for (size_t word = 0; word < m_cells.wordsPerRow(); word++) {
+      visitedCells[word] |= cells[word];
+    }
+  }
+}
+
+Cell::Status Model::cellStatus(std::size_t col, std::size_t row) const {
+  if (m_cells.at(col, row)) {
+    return Cell::Status::Alive;
+  }
+  return m_visitedCells.at(col, row) ? Cell::Status::Dead : Cell::Status::Empty;
+}
@@ -1,16 +1,78 @@
 #ifndef GAME_OF_LIFE_MODEL_HPP
 #define GAME_OF_LIFE_MODEL_HPP
 
+#include <cstdint>
+#include <deque>
+#include <iterator>
+#include <optional>
 #include <set>
+#include <utility>
 #include <vector>
 
 #include "Cell.hpp"
-#include <optional>
+#include "Grid.hpp"
+#include "HashLife.hpp"
+#include "History.hpp"
+#include "Kernel.hpp"
+#include "Rule.hpp"
+#include "SparseLife.hpp"
+#include "ThreadPool.hpp"
+#include "TileMap.hpp"
 
 class Model {
 public:
   enum class Status { ReadyToRun, Running, Paused, Stopped };
 
+  // Pattern already centred on the grid, with the cells that fall outside it
+  // and, when those are kept, the whole pattern on a sparse plane.
+  struct StagedPattern {
+    Grid cells;
+    std::vector<std::pair<SparseLife::Coord, SparseLife::Coord>> outerCells;
+    SparseLife plane;
+  };
+
+  // Steady state the grid has settled into: every generation from the start
+  // on repeats period generations later.
+  struct Cycle {
+    std::size_t period;
+    std::size_t startGeneration;
+  };
+
+  class CellIterator {
+  public:
+    using iterator_category = std::input_iterator_tag;
+    using value_type = Cell;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const Cell *;
+    using reference = Cell;
+
+    CellIterator(const Model &model, std::size_t index);
+
+    Cell operator*() const;
+    CellIterator &operator++();
+    CellIterator operator++(int);
+    bool operator==(const CellIterator &other) const;
+    bool operator!=(const CellIterator &other) const;
+
+  private:
+    const Model *m_model;
+    std::size_t m_index;
+  };
+
+  class Cells {
+  public:
+    explicit Cells(const Model &model);
+
+    CellIterator begin() const;
+    CellIterator end() const;
+    CellIterator cbegin() const;
+    CellIterator cend() const;
+    std::size_t size() const;
+
+  private:
+    const Model &m_model;
+  };
+
   Model(std::size_t width, std::size_t height);
 
   Status status() const;
@@ -22,12 +84,38 @@ public:
   std::size_t generation() const;
   std::size_t population() const;
   std::optional<Cell> cellAt(std::size_t col, std::size_t row) const;
-  const std::set<Cell> &initialPattern() const;
+  const Grid &initialPattern() const;
+  const Grid &aliveCells() const;
+  // Loads the live cells into the quadtree: the whole plane in unbounded
+  // mode, where the grid is only a window onto it, and the grid otherwise.
+  void storeCells(HashLife &cells) const;
+  const Grid &visitedCells() const;
   const std::set<std::size_t> &survivalRule() const;
   const std::set<std::size_t> &birthRule() const;
-  const std::vector<Cell> &cells() const;
+  Rule rule() const;
+  std::size_t memoryUsage() const;
+  std::size_t threadCount() const;
+  std::size_t tileCount() const;
+  std::size_t activeTileCount() const;
+  const TileMap &tiles() const;
+  bool isUnbounded() const;
+  std::size_t historyMemoryUsage() const;
+  std::size_t rewindableGenerations() const;
+  std::optional<Cycle> cycle() const;
+  // Seed of the last generated population.
+  std::uint64_t populationSeed() const;
+  Cells cells() const;
+  StagedPattern stagePattern(const Grid &pattern, bool keepOuterCells) const;
+  StagedPattern stagePattern(const HashLife &pattern,
+                             bool keepOuterCells) const;
 
   void update();
+  // Advances 2^log2Generations generations with HashLife. Returns false,
+  // doing nothing, when the rule has B0, or when on the bounded grid the live
+  // cells could reach an edge within that many generations.
+  bool jump(std::size_t log2Generations);
+  bool fastForward(std::size_t generations);
+  std::size_t rewind(std::size_t generations);
   void run();
   void pause();
   void clear();
@@ -35,16 +123,38 @@ public:
   void speedUp();
   void slowDown();
   void generatePopulation(double density);
+  void generatePopulation(double density, std::uint64_t seed);
   void insertCell(const Cell &cell);
   void removeCell(const Cell &cell);
-  void insertPattern(const std::set<Cell> &pattern);
+  void insertPattern(const Grid &pattern);
+  void insertPattern(StagedPattern &&pattern);
+  void restore(Grid &&cells, Rule rule, std::size_t generation);
   void setSurvivalRule(const std::set<std::size_t> &rule);
   void setBirthRule(const std::set<std::size_t> &rule);
+  // Rules with B0 cannot run unbounded: setting one while unbounded, or
+  // going unbounded with one, throws std::invalid_argument and leaves the
+  // model as it was.
+  void setRule(Rule rule);
+  void setThreadCount(std::size_t count);
+  void setHashLifeMemoryLimit(std::size_t bytes);
+  void setHistoryMemoryLimit(std::size_t bytes);
+  void setUnbounded(bool isUnbounded);
+  void clearDirtyTiles();
 
 private:
   void updateStatus();
+  void updateRule();
+  void loadSparseCells();
+  void storeSparseCells();
+  void markVisitedCells();
+  void resetCycleDetection();
+  void detectCycle();
+  bool repeatsAfter(std::size_t generations);
+  void splitTileRows();
+  kernel::StepChange stepTask(const Grid &current, Grid &next, Grid &visited,
+                              TileMap &tiles, std::size_t task) const;
 
-  std::size_t toCellIndex(std::size_t col, std::size_t row) const;
+  Cell::Status cellStatus(std::size_t col, std::size_t row) const;
 
   const std::size_t m_width;
   const std::size_t m_height;
@@ -53,12 +163,32 @@ private:
   std::size_t m_speed;
   std::size_t m_generation;
   std::size_t m_population;
-  std::set<Cell> m_initialPattern;
+  Grid m_initialPattern;
   std::set<std::size_t> m_survivalRule;
   std::set<std::size_t> m_birthRule;
-  std::vector<std::vector<Cell::Status>> m_cellStatus;
-  std::vector<std::vector<Cell::Status>> m_updatedCellStatus;
-  std::vector<Cell> m_cells;
+  Rule m_rule;
+  kernel::RuleKernel m_kernel;
+  Grid m_cells;
+  Grid m_nextCells;
+  Grid m_visitedCells;
+  TileMap m_tiles;
+  // Tile rows are split into this many column ranges, so that a generation
+  // makes enough tasks to keep every thread busy.
+  std::size_t m_tileRowSplits;
+  // What every task changed in the last generation, sized with the thread
+  // count.
+  std::vector<kernel::StepChange> m_stepChanges;
+  HashLife m_hashLife;
+  History m_history;
+  std::uint64_t m_hash;
+  std::deque<std::pair<std::uint64_t, std::size_t>> m_recentHashes;
+  std::optional<Cycle> m_cycle;
+  SparseLife m_sparseCells;
+  std::vector<std::pair<SparseLife::Coord, SparseLife::Coord>>
+      m_initialOuterCells;
+  bool m_isUnbounded;
+  std::uint64_t m_populationSeed;
+  ThreadPool m_threadPool;
 };
 
 #endif
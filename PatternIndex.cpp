@@ -0,0 +1,174 @@
+#include "PatternIndex.hpp"
+
+#include <array>
+#include <chrono>
+#include <exception>
+
+#include "Checkpoint.hpp"
+#include "MacrocellHelper.hpp"
+#include "RleHelper.hpp"
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace {
+constexpr auto f_rescanPeriod{std::chrono::seconds{1}};
+#ifdef __linux__
+constexpr auto f_notifyTimeoutMs{100};
+constexpr std::size_t f_notifyBufferSize{4096};
+constexpr std::uint32_t f_notifyEvents{IN_CREATE | IN_DELETE | IN_CLOSE_WRITE |
+                                       IN_MOVED_FROM | IN_MOVED_TO |
+                                       IN_DELETE_SELF | IN_MOVE_SELF};
+#endif
+
+PatternIndex::Entry describe(const std::string &name,
+                             const std::filesystem::path &path) {
+  try {
+    if (checkpoint::isCheckpointFile(path)) {
+      auto summary{checkpoint::loadSummary(path)};
+      return {name, summary.width, summary.height, summary.population,
+              summary.rule, {}};
+    }
+    if (mc::isMacrocellFile(path)) {
+      HashLife pattern;
+      auto rule{mc::loadPatternFile(path, pattern)};
+      auto bounds{pattern.bounds().value_or(HashLife::Bounds{0, 0, -1, -1})};
+      return {name,
+              static_cast<std::size_t>(bounds.right - bounds.left + 1),
+              static_cast<std::size_t>(bounds.bottom - bounds.top + 1),
+              static_cast<std::size_t>(pattern.population()),
+              rule,
+              {}};
+    }
+    auto pattern{rle::loadPatternFile(path)};
+    return {name, pattern.cells.width(), pattern.cells.height(),
+            pattern.cells.population(), pattern.rule, {}};
+  } catch (const std::exception &error) {
+    return {name, 0, 0, 0, {}, error.what()};
+  }
+}
+} // namespace
+
+PatternIndex::PatternIndex(std::filesystem::path folder)
+    : m_folder{std::move(folder)}, m_mutex{}, m_stopRequested{}, m_entries{},
+      m_cache{}, m_notifyHandle{-1}, m_watchHandle{-1}, m_isStopping{false},
+      m_worker{[this] { work(); }} {}
+
+PatternIndex::~PatternIndex() {
+  {
+    std::lock_guard lock{m_mutex};
+    m_isStopping = true;
+  }
+  m_stopRequested.notify_all();
+  m_worker.join();
+  unwatch();
+}
+
+std::shared_ptr<const PatternIndex::Entries> PatternIndex::entries() const {
+  std::lock_guard lock{m_mutex};
+  return m_entries;
+}
+
+bool PatternIndex::isStopping() const {
+  std::lock_guard lock{m_mutex};
+  return m_isStopping;
+}
+
+void PatternIndex::work() {
+  while (!isStopping()) {
+    watch();
+    scan();
+    waitForChange();
+  }
+}
+
+// Lists the folder and re-parses only the files whose size or modification
+// time changed since the previous scan.
+void PatternIndex::scan() {
+  std::map<std::string, CachedEntry> cache;
+  std::error_code error;
+  for (std::filesystem::directory_iterator it{m_folder, error}, end;
+       !error && it != end; it.increment(error)) {
+    const auto &path{it->path()};
+    std::error_code fileError;
+    if (!it->is_regular_file(fileError) || !rle::isPatternFile(path)) {
+      continue;
+    }
+    auto writeTime{it->last_write_time(fileError)};
+    auto size{it->file_size(fileError)};
+    if (fileError) {
+      continue;
+    }
+    auto name{path.filename().string()};
+    auto cached{m_cache.find(name)};
+    if (cached != m_cache.end() && cached->second.writeTime == writeTime &&
+        cached->second.size == size) {
+      cache.insert(m_cache.extract(cached));
+      continue;
+    }
+    cache.emplace(name, CachedEntry{writeTime, size, describe(name, path)});
+  }
+  m_cache = std::move(cache);
+  auto entries{std::make_shared<Entries>()};
+  entries->reserve(m_cache.size());
+  for (const auto &[name, cached] : m_cache) {
+    entries->push_back(cached.entry);
+  }
+  std::lock_guard lock{m_mutex};
+  m_entries = std::move(entries);
+}
+
+// Returns when the folder may have changed or the index is being destroyed.
+// Without inotify, or while the folder does not exist, it rescans
+// periodically instead.
+void PatternIndex::waitForChange() {
+#ifdef __linux__
+  while (m_watchHandle >= 0 && !isStopping()) {
+    pollfd request{m_notifyHandle, POLLIN, 0};
+    if (poll(&request, 1, f_notifyTimeoutMs) <= 0) {
+      continue;
+    }
+    alignas(inotify_event) std::array<char, f_notifyBufferSize> buffer;
+    ssize_t length;
+    while ((length = read(m_notifyHandle, buffer.data(), buffer.size())) > 0) {
+      for (ssize_t offset = 0; offset < length;) {
+        const auto *event{
+            reinterpret_cast<const inotify_event *>(buffer.data() + offset)};
+        if (event->mask & IN_IGNORED) {
+          m_watchHandle = -1;
+        }
+        offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+      }
+    }
+    return;
+  }
+#endif
+  std::unique_lock lock{m_mutex};
+  m_stopRequested.wait_for(lock, f_rescanPeriod,
+                           [this] { return m_isStopping; });
+}
+
+void PatternIndex::watch() {
+#ifdef __linux__
+  if (m_notifyHandle < 0) {
+    m_notifyHandle = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  }
+  if (m_notifyHandle >= 0 && m_watchHandle < 0) {
+    m_watchHandle = inotify_add_watch(m_notifyHandle, m_folder.c_str(),
+                                      f_notifyEvents);
+  }
+#endif
+}
+
+void PatternIndex::unwatch() {
+#ifdef __linux__
+  if (m_notifyHandle >= 0) {
+    close(m_notifyHandle);
+  }
+  m_notifyHandle = -1;
+  m_watchHandle = -1;
+#endif
+}
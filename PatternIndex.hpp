@@ -0,0 +1,67 @@
+#ifndef GAME_OF_LIFE_PATTERN_INDEX_HPP
+#define GAME_OF_LIFE_PATTERN_INDEX_HPP
+
+#include <condition_variable>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Rule.hpp"
+
+// Sorted list of the pattern files in a folder, with the metadata of each
+// one. A worker thread builds it once and rebuilds it whenever the folder
+// changes, re-parsing only the files that did, so readers never touch the
+// filesystem.
+class PatternIndex {
+public:
+  struct Entry {
+    std::string name;
+    std::size_t width;
+    std::size_t height;
+    std::size_t population;
+    std::optional<Rule> rule;
+    std::string error;
+  };
+
+  using Entries = std::vector<Entry>;
+
+  explicit PatternIndex(std::filesystem::path folder);
+  ~PatternIndex();
+
+  PatternIndex(const PatternIndex &) = delete;
+  PatternIndex &operator=(const PatternIndex &) = delete;
+
+  // Null until the first scan has finished.
+  std::shared_ptr<const Entries> entries() const;
+
+private:
+  struct CachedEntry {
+    std::filesystem::file_time_type writeTime;
+    std::uintmax_t size;
+    Entry entry;
+  };
+
+  bool isStopping() const;
+  void work();
+  void scan();
+  void waitForChange();
+  void watch();
+  void unwatch();
+
+  const std::filesystem::path m_folder;
+  mutable std::mutex m_mutex;
+  std::condition_variable m_stopRequested;
+  std::shared_ptr<const Entries> m_entries;
+  std::map<std::string, CachedEntry> m_cache;
+  int m_notifyHandle;
+  int m_watchHandle;
+  bool m_isStopping;
+  std::thread m_worker;
+};
+
+#endif
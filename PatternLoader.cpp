@@ -0,0 +1,109 @@
+#include "PatternLoader.hpp"
+
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "Checkpoint.hpp"
+#include "MacrocellHelper.hpp"
+#include "RleHelper.hpp"
+
+namespace {
+// Share of the progress bar taken by parsing; staging takes the rest.
+constexpr auto f_parseProgressShare{.9f};
+} // namespace
+
+PatternLoader::PatternLoader(const Model &model)
+    : m_model{model}, m_mutex{}, m_status{Status::Idle}, m_name{}, m_error{},
+      m_result{}, m_progress{0.f}, m_isCancelled{false}, m_worker{} {}
+
+PatternLoader::~PatternLoader() { cancel(); }
+
+PatternLoader::Status PatternLoader::status() const {
+  std::lock_guard lock{m_mutex};
+  return m_status;
+}
+
+const std::string &PatternLoader::name() const { return m_name; }
+
+float PatternLoader::progress() const { return m_progress; }
+
+std::string PatternLoader::error() const {
+  std::lock_guard lock{m_mutex};
+  return m_error;
+}
+
+void PatternLoader::load(const std::string &name, bool keepOuterCells) {
+  cancel();
+  m_name = name;
+  m_progress = 0.f;
+  m_status = Status::Loading;
+  m_worker = std::thread{
+      [this, name, keepOuterCells] { work(name, keepOuterCells); }};
+}
+
+// Stops the parse at its next progress report and drops any result that was
+// not taken yet.
+void PatternLoader::cancel() {
+  m_isCancelled = true;
+  if (m_worker.joinable()) {
+    m_worker.join();
+  }
+  m_isCancelled = false;
+  m_status = Status::Idle;
+  m_error.clear();
+  m_result.reset();
+}
+
+// Hands over the staged pattern once the load succeeded.
+std::optional<PatternLoader::Result> PatternLoader::take() {
+  std::lock_guard lock{m_mutex};
+  if (m_status != Status::Ready) {
+    return {};
+  }
+  m_status = Status::Idle;
+  return std::exchange(m_result, std::nullopt);
+}
+
+void PatternLoader::work(std::string name, bool keepOuterCells) {
+  try {
+    auto progress{[this](float fraction) {
+      m_progress = fraction * f_parseProgressShare;
+      return !m_isCancelled;
+    }};
+    std::optional<Result> result;
+    auto path{rle::patternPath(name)};
+    if (checkpoint::isCheckpointFile(path)) {
+      auto snapshot{checkpoint::load(path)};
+      if (snapshot.cells.width() != m_model.width() ||
+          snapshot.cells.height() != m_model.height()) {
+        throw std::runtime_error{
+            "checkpoint is " + std::to_string(snapshot.cells.width()) + "x" +
+            std::to_string(snapshot.cells.height()) + ", grid is " +
+            std::to_string(m_model.width()) + "x" +
+            std::to_string(m_model.height())};
+      }
+      result = Result{{std::move(snapshot.cells), {}, {}},
+                      snapshot.rule,
+                      snapshot.generation};
+    } else if (mc::isMacrocellFile(path)) {
+      HashLife pattern;
+      auto rule{mc::loadPatternFile(path, pattern, progress)};
+      result = Result{m_model.stagePattern(pattern, keepOuterCells), rule, {}};
+    } else {
+      auto pattern{rle::loadPatternFile(path, progress)};
+      result = Result{m_model.stagePattern(pattern.cells, keepOuterCells),
+                      pattern.rule,
+                      {}};
+    }
+    m_progress = 1.f;
+    std::lock_guard lock{m_mutex};
+    m_result = std::move(result);
+    m_status = Status::Ready;
+  } catch (const rle::Cancelled &) {
+  } catch (const std::exception &error) {
+    std::lock_guard lock{m_mutex};
+    m_error = error.what();
+    m_status = Status::Failed;
+  }
+}
@@ -0,0 +1,55 @@
+#ifndef GAME_OF_LIFE_PATTERN_LOADER_HPP
+#define GAME_OF_LIFE_PATTERN_LOADER_HPP
+
+#include <atomic>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+
+#include "Model.hpp"
+#include "Rule.hpp"
+
+// Parses a pattern file and stages it for a model on a worker thread, so the
+// caller only has to swap the result in once it is ready.
+class PatternLoader {
+public:
+  enum class Status { Idle, Loading, Ready, Failed };
+
+  struct Result {
+    Model::StagedPattern pattern;
+    std::optional<Rule> rule;
+    // Set when the file is a checkpoint to resume rather than a pattern.
+    std::optional<std::size_t> generation;
+  };
+
+  explicit PatternLoader(const Model &model);
+  ~PatternLoader();
+
+  PatternLoader(const PatternLoader &) = delete;
+  PatternLoader &operator=(const PatternLoader &) = delete;
+
+  Status status() const;
+  const std::string &name() const;
+  float progress() const;
+  std::string error() const;
+
+  void load(const std::string &name, bool keepOuterCells);
+  void cancel();
+  std::optional<Result> take();
+
+private:
+  void work(std::string name, bool keepOuterCells);
+
+  const Model &m_model;
+  mutable std::mutex m_mutex;
+  Status m_status;
+  std::string m_name;
+  std::string m_error;
+  std::optional<Result> m_result;
+  std::atomic<float> m_progress;
+  std::atomic<bool> m_isCancelled;
+  std::thread m_worker;
+};
+
+#endif
@@ -0,0 +1,133 @@
+#include "Profiler.hpp"
+
+#include <algorithm>
+#include <fstream>
+
+namespace {
+constexpr std::size_t f_windowSize{256};
+constexpr std::size_t f_maxTraceEvents{1 << 20};
+
+std::size_t threadIndex() {
+  static std::atomic<std::size_t> s_threadCount{0};
+  thread_local const auto index{s_threadCount++};
+  return index;
+}
+
+double percentile(std::vector<double> &durations, double fraction) {
+  auto index{static_cast<std::size_t>(
+      fraction * static_cast<double>(durations.size() - 1))};
+  std::nth_element(durations.begin(), durations.begin() + index,
+                   durations.end());
+  return durations[index];
+}
+} // namespace
+
+Profiler::Profiler()
+    : m_isEnabled{false}, m_isTracing{false}, m_mutex{}, m_durations{},
+      m_nextDuration{}, m_traceEvents{}, m_traceStart{} {}
+
+Profiler &Profiler::instance() {
+  static Profiler profiler;
+  return profiler;
+}
+
+const char *Profiler::name(Stage stage) {
+  switch (stage) {
+  case Stage::Frame:
+    return "Frame";
+  case Stage::Events:
+    return "Events";
+  case Stage::ModelUpdate:
+    return "Model update";
+  case Stage::DrawCells:
+    return "Draw cells";
+  case Stage::DrawGrid:
+    return "Draw grid";
+  case Stage::DrawMenu:
+  default:
+    return "Draw menu";
+  }
+}
+
+bool Profiler::isEnabled() const {
+  return m_isEnabled.load(std::memory_order_relaxed);
+}
+
+bool Profiler::isTracing() const {
+  return m_isTracing.load(std::memory_order_relaxed);
+}
+
+Profiler::Statistics Profiler::statistics(Stage stage) const {
+  std::vector<double> durations;
+  {
+    std::lock_guard lock{m_mutex};
+    durations = m_durations[static_cast<std::size_t>(stage)];
+  }
+  if (durations.empty()) {
+    return {0, 0., 0.};
+  }
+  auto p50{percentile(durations, .5)};
+  auto p99{percentile(durations, .99)};
+  return {durations.size(), p50, p99};
+}
+
+void Profiler::setEnabled(bool isEnabled) {
+  std::lock_guard lock{m_mutex};
+  if (!isEnabled) {
+    m_isTracing = false;
+  }
+  for (auto &durations : m_durations) {
+    durations.clear();
+  }
+  m_nextDuration.fill(0);
+  m_isEnabled = isEnabled;
+}
+
+void Profiler::startTrace() {
+  std::lock_guard lock{m_mutex};
+  m_traceEvents.clear();
+  m_traceStart = Clock::now();
+  m_isTracing = true;
+  m_isEnabled = true;
+}
+
+bool Profiler::writeTrace(const std::string &path) const {
+  std::ofstream file{path};
+  if (!file) {
+    return false;
+  }
+  std::lock_guard lock{m_mutex};
+  file << "{\"traceEvents\":[";
+  auto separator{""};
+  for (const auto &event : m_traceEvents) {
+    std::chrono::duration<double, std::micro> start{event.start -
+                                                    m_traceStart};
+    std::chrono::duration<double, std::micro> duration{event.duration};
+    file << separator << "\n{\"name\":\"" << name(event.stage)
+         << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << event.thread
+         << ",\"ts\":" << start.count() << ",\"dur\":" << duration.count()
+         << "}";
+    separator = ",";
+  }
+  file << "\n]}\n";
+  return static_cast<bool>(file);
+}
+
+void Profiler::record(Stage stage, Clock::time_point start,
+                      Clock::time_point end) {
+  auto index{static_cast<std::size_t>(stage)};
+  auto thread{threadIndex()};
+  std::lock_guard lock{m_mutex};
+  auto &durations{m_durations[index]};
+  std::chrono::duration<double, std::milli> duration{end - start};
+  if (durations.size() < f_windowSize) {
+    durations.push_back(duration.count());
+  } else {
+    durations[m_nextDuration[index]] = duration.count();
+  }
+  m_nextDuration[index] = (m_nextDuration[index] + 1) % f_windowSize;
+  if (m_isTracing && start >= m_traceStart &&
+      m_traceEvents.size() < f_maxTraceEvents) {
+    m_traceEvents.push_back({stage, thread, start, end - start});
+  }
+}
@@ -0,0 +1,105 @@
+#ifndef GAME_OF_LIFE_PROFILER_HPP
+#define GAME_OF_LIFE_PROFILER_HPP
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Times the stages of a frame and of a generation. Scoped timers placed with
+// PROFILE_SCOPE only cost a relaxed atomic load while the profiler is off,
+// and nothing at all in builds without GAME_OF_LIFE_PROFILER. While on, the
+// latest durations of every stage are kept to report percentiles, and while
+// tracing every timed scope is also kept to be written as a Chrome trace.
+class Profiler {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  enum class Stage {
+    Frame,
+    Events,
+    ModelUpdate,
+    DrawCells,
+    DrawGrid,
+    DrawMenu
+  };
+
+  static constexpr std::size_t stageCount{6};
+
+  // Durations in milliseconds over the latest samples.
+  struct Statistics {
+    std::size_t samples;
+    double p50;
+    double p99;
+  };
+
+  class ScopedTimer {
+  public:
+    explicit ScopedTimer(Stage stage)
+        : m_stage{stage}, m_isActive{instance().isEnabled()},
+          m_start{m_isActive ? Clock::now() : Clock::time_point{}} {}
+    ~ScopedTimer() {
+      if (m_isActive) {
+        instance().record(m_stage, m_start, Clock::now());
+      }
+    }
+
+    ScopedTimer(const ScopedTimer &) = delete;
+    ScopedTimer &operator=(const ScopedTimer &) = delete;
+
+  private:
+    Stage m_stage;
+    bool m_isActive;
+    Clock::time_point m_start;
+  };
+
+  static Profiler &instance();
+  static const char *name(Stage stage);
+
+  bool isEnabled() const;
+  bool isTracing() const;
+  Statistics statistics(Stage stage) const;
+
+  // Turning the profiler off also stops tracing.
+  void setEnabled(bool isEnabled);
+  // Turns the profiler on and keeps every timed scope from now on, up to a
+  // bounded number of them.
+  void startTrace();
+  // Writes the kept scopes in the Chrome trace event format, as read by
+  // chrome://tracing or Perfetto, and returns whether it could.
+  bool writeTrace(const std::string &path) const;
+  void record(Stage stage, Clock::time_point start, Clock::time_point end);
+
+private:
+  struct TraceEvent {
+    Stage stage;
+    std::size_t thread;
+    Clock::time_point start;
+    Clock::duration duration;
+  };
+
+  Profiler();
+
+  std::atomic<bool> m_isEnabled;
+  std::atomic<bool> m_isTracing;
+  mutable std::mutex m_mutex;
+  // Rolling window of the latest durations of every stage, in milliseconds.
+  std::array<std::vector<double>, stageCount> m_durations;
+  std::array<std::size_t, stageCount> m_nextDuration;
+  std::vector<TraceEvent> m_traceEvents;
+  Clock::time_point m_traceStart;
+};
+
+#ifdef GAME_OF_LIFE_PROFILER
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_SCOPE(stage)                                                   \
+  Profiler::ScopedTimer PROFILE_CONCAT(scopedTimer, __LINE__) { stage }
+#else
+#define PROFILE_SCOPE(stage)
+#endif
+
+#endif
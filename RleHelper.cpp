@@ -1,172 +1,546 @@
 #include "RleHelper.hpp"
 
+#include <algorithm>
+#include <bitset>
+#include <cctype>
 #include <filesystem>
 #include <fstream>
-#include <regex>
+#include <limits>
+
+#include "Checkpoint.hpp"
+#include "HashLife.hpp"
+#include "MacrocellHelper.hpp"
 
 namespace {
 constexpr auto f_patternsFolder{"../patterns/"};
 constexpr auto f_nextRowSymbol{'$'};
 constexpr auto f_deadCellSymbol{'b'};
 constexpr auto f_aliveCellSymbol{'o'};
+constexpr auto f_plainDeadCellSymbol{'.'};
+constexpr auto f_plainAliveCellSymbol{'A'};
 constexpr auto f_endOfLine{'\n'};
 constexpr auto f_endOfPatternSymbol{'!'};
+constexpr auto f_commentSymbol{'#'};
+constexpr auto f_headerSeparator{','};
+constexpr auto f_headerAssignment{'='};
+constexpr auto f_widthKey{"x"};
+constexpr auto f_heightKey{"y"};
+constexpr auto f_ruleKey{"rule"};
 constexpr auto f_rleFileExtension{".rle"};
-const std::regex f_rleCommentRegex{"#.*"};
-const std::regex f_rleHeaderRegex{"x = [0-9]*, y = [0-9]*(, rule=.*)?"};
-const std::regex f_rleContentRegex("([0-9]*)(o|b)(?:([0-9]*)(\\$))?");
-
-std::set<Cell> map(const std::string &pattern) {
-  std::set<Cell> result;
-  std::smatch match;
-  Cell cell;
-  auto it = pattern.cbegin();
-  while (it != pattern.cend()) {
-    if (std::regex_search(it, pattern.cend(), match, f_rleContentRegex)) {
-      auto consecutiveCells{std::max(1, std::atoi(match[1].str().c_str()))};
-      if (match[2] == f_aliveCellSymbol) {
-        for (auto i = 0; i < consecutiveCells; i++) {
-          result.insert(cell);
-          cell.col++;
+constexpr auto f_birthSymbol{'B'};
+constexpr auto f_survivalSymbol{'S'};
+constexpr auto f_ruleSeparator{'/'};
+constexpr auto f_ruleSuffixSeparator{':'};
+constexpr auto f_maxNeighbourCount{8};
+constexpr std::size_t f_maxLineLength{70};
+constexpr std::size_t f_progressInterval{std::size_t{1} << 20};
+// Half a gigabyte of bits; larger patterns are better stored as macrocells.
+constexpr std::size_t f_maxPatternCells{std::size_t{1} << 32};
+constexpr std::size_t f_maxRunDigits{
+    std::numeric_limits<std::size_t>::digits10 + 1};
+constexpr std::size_t f_maxRunLength{std::numeric_limits<std::size_t>::max()};
+
+std::optional<std::uint16_t> parseRuleMask(const std::string &digits) {
+  std::uint16_t mask{0};
+  for (auto digit : digits) {
+    auto count{digit - '0'};
+    if (count < 0 || count > f_maxNeighbourCount) {
+      return {};
+    }
+    mask = static_cast<std::uint16_t>(mask | (1u << count));
+  }
+  return mask;
+}
+
+inline bool isBlank(char c) {
+  return c == ' ' || c == '\t' || c == '\r' || c == f_endOfLine;
+}
+
+inline bool isDigit(char c) { return c >= '0' && c <= '9'; }
+
+// Single pass over the text of an RLE file that keeps track of the position
+// of every character, so errors can point at it.
+class Parser {
+public:
+  Parser(std::string_view text, const rle::ProgressCallback &progress)
+      : m_text{text}, m_progress{progress}, m_position{0}, m_line{1},
+        m_lineStart{0}, m_nextReport{f_progressInterval} {}
+
+  rle::Pattern parse() {
+    skipComments();
+    auto [width, height, rule]{parseHeader()};
+    rle::Pattern pattern{Grid{width, height}, rule};
+    parseCells(pattern.cells);
+    return pattern;
+  }
+
+private:
+  struct Header {
+    std::size_t width;
+    std::size_t height;
+    std::optional<Rule> rule;
+  };
+
+  bool isAtEnd() const { return m_position == m_text.size(); }
+
+  char peek() const { return isAtEnd() ? '\0' : m_text[m_position]; }
+
+  void advance() {
+    if (m_text[m_position++] == f_endOfLine) {
+      m_line++;
+      m_lineStart = m_position;
+    }
+  }
+
+  [[noreturn]] void fail(const std::string &message) const {
+    throw rle::ParseError{message, m_line, m_position - m_lineStart + 1};
+  }
+
+  void skipLine() {
+    while (!isAtEnd() && peek() != f_endOfLine) {
+      advance();
+    }
+  }
+
+  void skipSpaces() {
+    while (peek() == ' ' || peek() == '\t') {
+      advance();
+    }
+  }
+
+  void skipComments() {
+    while (!isAtEnd() && (isBlank(peek()) || peek() == f_commentSymbol)) {
+      if (peek() == f_commentSymbol) {
+        skipLine();
+      } else {
+        advance();
+      }
+    }
+  }
+
+  std::string parseWord() {
+    std::string word;
+    while (!isAtEnd() && !isBlank(peek()) && peek() != f_headerSeparator &&
+           peek() != f_headerAssignment) {
+      word.push_back(peek());
+      advance();
+    }
+    return word;
+  }
+
+  // The rule is the last key of the header, and a bounded grid suffix such
+  // as B3/S23:T100,100 holds a comma, so its value runs to the end of the
+  // line.
+  std::string parseLineEnd() {
+    std::string value;
+    while (!isAtEnd() && peek() != f_endOfLine) {
+      value.push_back(peek());
+      advance();
+    }
+    while (!value.empty() && isBlank(value.back())) {
+      value.pop_back();
+    }
+    return value;
+  }
+
+  std::size_t parseNumber() {
+    if (!isDigit(peek())) {
+      fail("expected a number");
+    }
+    std::size_t number{0};
+    while (isDigit(peek())) {
+      auto digit{static_cast<std::size_t>(peek() - '0')};
+      if (number > (f_maxRunLength - digit) / 10) {
+        fail("number too large");
+      }
+      number = number * 10 + digit;
+      m_position++;
+    }
+    return number;
+  }
+
+  Header parseHeader() {
+    std::optional<std::size_t> width;
+    std::optional<std::size_t> height;
+    std::optional<Rule> rule;
+    while (!isAtEnd() && peek() != f_endOfLine) {
+      skipSpaces();
+      auto key{parseWord()};
+      skipSpaces();
+      if (key.empty() || peek() != f_headerAssignment) {
+        fail("expected 'key = value' in header");
+      }
+      advance();
+      skipSpaces();
+      if (key == f_widthKey) {
+        width = parseNumber();
+      } else if (key == f_heightKey) {
+        height = parseNumber();
+      } else if (key == f_ruleKey) {
+        rule = rle::parseRule(parseLineEnd());
+        if (!rule) {
+          fail("unsupported rule");
         }
       } else {
-        cell.col += consecutiveCells;
+        parseWord();
+      }
+      skipSpaces();
+      if (peek() == f_headerSeparator) {
+        advance();
+      } else if (!isAtEnd() && !isBlank(peek())) {
+        fail("expected ',' in header");
+      }
+      skipSpaces();
+      if (peek() == '\r') {
+        advance();
       }
     }
-    it = match.suffix().first;
-    auto rowsSkipped{std::max(1, std::atoi(match[3].str().c_str()))};
-    if (match[4] == f_nextRowSymbol) {
-      cell.row += rowsSkipped;
-      cell.col = 0;
-    } else if (*it == f_endOfPatternSymbol) {
-      it++;
+    if (!width || !height) {
+      fail("header must give x and y");
+    }
+    auto maxHeight{f_maxPatternCells / std::max(width.value(), std::size_t{1})};
+    if (height.value() > maxHeight) {
+      fail("pattern too large");
+    }
+    return {width.value(), height.value(), rule};
+  }
+
+  void parseCells(Grid &cells) {
+    std::size_t col{0};
+    std::size_t row{0};
+    while (!isAtEnd()) {
+      if (m_position >= m_nextReport) {
+        reportProgress();
+      }
+      if (isBlank(peek())) {
+        advance();
+        continue;
+      }
+      std::size_t count{1};
+      if (isDigit(peek())) {
+        count = parseNumber();
+      }
+      switch (peek()) {
+      case f_deadCellSymbol:
+      case f_plainDeadCellSymbol:
+        if (count > cells.width() - col) {
+          fail("cells outside the x and y given in the header");
+        }
+        col += count;
+        break;
+      case f_aliveCellSymbol:
+      case f_plainAliveCellSymbol:
+        if (row >= cells.height() || count > cells.width() - col) {
+          fail("cells outside the x and y given in the header");
+        }
+        setRun(cells, row, col, count);
+        col += count;
+        break;
+      case f_nextRowSymbol:
+        if (count > cells.height() - row) {
+          fail("rows outside the x and y given in the header");
+        }
+        row += count;
+        col = 0;
+        break;
+      case f_endOfPatternSymbol:
+        return;
+      case f_commentSymbol:
+        if (m_position != m_lineStart) {
+          fail("unexpected '#'");
+        }
+        skipLine();
+        continue;
+      default:
+        fail(isAtEnd() ? "expected a cell after run count"
+                       : std::string{"unexpected '"} + peek() + "'");
+      }
+      m_position++;
+    }
+  }
+
+  void reportProgress() {
+    m_nextReport = m_position + f_progressInterval;
+    auto fraction{static_cast<float>(m_position) /
+                  static_cast<float>(m_text.size())};
+    if (m_progress && !m_progress(fraction)) {
+      throw rle::Cancelled{};
+    }
+  }
+
+  // Sets `count` cells starting at `col` a word at a time.
+  static void setRun(Grid &cells, std::size_t row, std::size_t col,
+                     std::size_t count) {
+    auto *words{cells.row(row)};
+    while (count > 0) {
+      auto bit{col % Grid::bitsPerWord};
+      auto bits{std::min(count, Grid::bitsPerWord - bit)};
+      auto mask{bits == Grid::bitsPerWord ? ~Grid::Word{0}
+                                          : ((Grid::Word{1} << bits) - 1)};
+      words[col / Grid::bitsPerWord] |= mask << bit;
+      col += bits;
+      count -= bits;
+    }
+  }
+
+  std::string_view m_text;
+  const rle::ProgressCallback &m_progress;
+  std::size_t m_position;
+  std::size_t m_line;
+  std::size_t m_lineStart;
+  std::size_t m_nextReport;
+};
+
+// Accumulates runs into lines no longer than the RLE format recommends, and
+// hands the whole text to the stream at once.
+class Writer {
+public:
+  explicit Writer(std::ostream &stream)
+      : m_stream{stream}, m_text{}, m_lineStart{0} {}
+
+  void write(std::size_t count, char symbol) {
+    char run[f_maxRunDigits + 1];
+    auto *first{std::end(run)};
+    *--first = symbol;
+    for (auto digits{count > 1 ? count : 0}; digits > 0; digits /= 10) {
+      *--first = static_cast<char>('0' + digits % 10);
+    }
+    auto length{static_cast<std::size_t>(std::end(run) - first)};
+    if (m_text.size() - m_lineStart + length > f_maxLineLength) {
+      m_text.push_back(f_endOfLine);
+      m_lineStart = m_text.size();
+    }
+    m_text.append(first, length);
+  }
+
+  void finish() {
+    write(1, f_endOfPatternSymbol);
+    m_text.push_back(f_endOfLine);
+    m_stream.write(m_text.data(), static_cast<std::streamsize>(m_text.size()));
+  }
+
+private:
+  std::ostream &m_stream;
+  std::string m_text;
+  std::size_t m_lineStart;
+};
+
+// Returns the first column from `col` on whose state differs from `alive`,
+// or `end` if there is none before it.
+std::size_t findRunEnd(const Grid::Word *words, std::size_t col,
+                       std::size_t end, bool alive) {
+  while (col < end) {
+    auto word{words[col / Grid::bitsPerWord]};
+    auto bits{(alive ? ~word : word) >> (col % Grid::bitsPerWord)};
+    if (bits == 0) {
+      col += Grid::bitsPerWord - col % Grid::bitsPerWord;
+      continue;
     }
+    auto lowestBit{bits & (~bits + 1)};
+    auto offset{std::bitset<Grid::bitsPerWord>{lowestBit - 1}.count()};
+    return std::min(col + offset, end);
   }
-  return result;
+  return end;
 }
 
-Cell mostLeftCell(const std::set<Cell> &pattern) {
-  return *std::min_element(
-      pattern.cbegin(), pattern.cend(),
-      [](const auto &a, const auto &b) { return a.col < b.col; });
+// Copies the live part of a quadtree onto a grid just large enough for it.
+Grid toGrid(const HashLife &cells) {
+  auto bounds{cells.bounds()};
+  if (!bounds) {
+    return Grid{0, 0};
+  }
+  auto width{static_cast<std::size_t>(bounds->right - bounds->left + 1)};
+  auto height{static_cast<std::size_t>(bounds->bottom - bounds->top + 1)};
+  if (height > f_maxPatternCells / width) {
+    throw std::runtime_error{"pattern too large for a grid"};
+  }
+  Grid grid{width, height};
+  cells.store(grid, -bounds->left, -bounds->top);
+  return grid;
 }
+}  // namespace
+
+namespace rle {
+ParseError::ParseError(const std::string &message, std::size_t line,
+                       std::size_t column)
+    : std::runtime_error{std::to_string(line) + ":" + std::to_string(column) +
+                         ": " + message},
+      m_line{line}, m_column{column} {}
+
+std::size_t ParseError::line() const { return m_line; }
+
+std::size_t ParseError::column() const { return m_column; }
+
+Cancelled::Cancelled() : std::runtime_error{"cancelled"} {}
+
+std::filesystem::path patternsFolder() { return f_patternsFolder; }
 
-Cell mostRightCell(const std::set<Cell> &pattern) {
-  return *std::max_element(
-      pattern.cbegin(), pattern.cend(),
-      [](const auto &a, const auto &b) { return a.col < b.col; });
+bool isPatternFile(const std::filesystem::path &path) {
+  return path.extension().string() == f_rleFileExtension ||
+         mc::isMacrocellFile(path) || checkpoint::isCheckpointFile(path);
 }
 
-Cell mostTopCell(const std::set<Cell> &pattern) {
-  return *std::min_element(
-      pattern.cbegin(), pattern.cend(),
-      [](const auto &a, const auto &b) { return a.row < b.row; });
+// Names without a pattern file extension are taken as RLE files.
+std::filesystem::path patternPath(const std::string &name) {
+  std::filesystem::path path{f_patternsFolder + name};
+  if (!isPatternFile(path)) {
+    path += f_rleFileExtension;
+  }
+  return path;
 }
 
-Cell mostBottomCell(const std::set<Cell> &pattern) {
-  return *std::max_element(
-      pattern.cbegin(), pattern.cend(),
-      [](const auto &a, const auto &b) { return a.row < b.row; });
+Pattern parsePattern(std::string_view text, const ProgressCallback &progress) {
+  return Parser{text, progress}.parse();
 }
-}  // namespace
 
-namespace rle {
-std::set<std::string> listPatternNames() {
-  std::set<std::string> files;
-  if (!std::filesystem::exists(f_patternsFolder)) {
-    return {};
+Pattern loadPatternFile(const std::filesystem::path &path,
+                        const ProgressCallback &progress) {
+  if (mc::isMacrocellFile(path)) {
+    HashLife cells;
+    auto rule{mc::loadPatternFile(path, cells, progress)};
+    return {toGrid(cells), rule};
   }
-  for (const auto &file :
-       std::filesystem::directory_iterator(f_patternsFolder)) {
-    if (file.path().extension().string() == f_rleFileExtension) {
-      files.insert(file.path().filename().stem().string());
-    }
+  if (checkpoint::isCheckpointFile(path)) {
+    auto snapshot{checkpoint::load(path)};
+    return {std::move(snapshot.cells), snapshot.rule};
+  }
+  std::ifstream istrm{path, std::ios::binary};
+  if (!istrm) {
+    throw std::runtime_error{"cannot open " + path.string()};
   }
-  return files;
+  std::string text(std::filesystem::file_size(path), '\0');
+  istrm.read(text.data(), static_cast<std::streamsize>(text.size()));
+  text.resize(static_cast<std::size_t>(istrm.gcount()));
+  return parsePattern(text, progress);
 }
 
-std::set<Cell> loadPattern(const std::string &name) {
-  std::string pattern;
-  std::string line;
-  std::ifstream istrm;
-  istrm.open(f_patternsFolder + name + f_rleFileExtension);
-  while (std::getline(istrm, line)) {
-    if (!std::regex_search(line, f_rleCommentRegex) &&
-        !std::regex_search(line, f_rleHeaderRegex)) {
-      if (line.back() == f_endOfLine) {
-        line.pop_back();
-      }
-      pattern.append(line);
-    }
+void savePattern(const std::string &name, const Grid &pattern, Rule rule) {
+  if (!std::filesystem::is_directory(f_patternsFolder) ||
+      !std::filesystem::exists(f_patternsFolder)) {
+    std::filesystem::create_directory(f_patternsFolder);
   }
-  istrm.close();
-  return map(pattern);
+  savePatternFile(patternPath(name), pattern, rule);
 }
 
-void savePattern(const std::string &name, const std::set<Cell> &pattern) {
-  if (pattern.empty()) {
+// Writes a whole plane, as a macrocell without going through a grid, and as
+// RLE through a grid just large enough for its live cells.
+void savePatternFile(const std::filesystem::path &path,
+                     const HashLife &pattern, Rule rule) {
+  if (mc::isMacrocellFile(path)) {
+    mc::savePatternFile(path, pattern, rule);
     return;
   }
-  if (!std::filesystem::is_directory(f_patternsFolder) ||
-      !std::filesystem::exists(f_patternsFolder)) {
-    std::filesystem::create_directory(f_patternsFolder);
+  savePatternFile(path, toGrid(pattern), rule);
+}
+
+void savePatternFile(const std::filesystem::path &path, const Grid &pattern,
+                     Rule rule) {
+  if (mc::isMacrocellFile(path)) {
+    HashLife cells;
+    cells.load(pattern);
+    mc::savePatternFile(path, cells, rule);
+    return;
   }
-  std::ofstream ostrm;
-  ostrm.open(f_patternsFolder + name + f_rleFileExtension);
-  ostrm << "#N " << name << std::endl;
-  auto minCol{mostLeftCell(pattern).col};
-  auto minRow{mostTopCell(pattern).row};
-  auto maxCol{mostRightCell(pattern).col};
-  auto maxRow{mostBottomCell(pattern).row};
-  ostrm << "x = " << maxCol - minCol;
-  ostrm << ", y = " << maxRow - minRow << std::endl;
-  size_t prevCol{0};
-  size_t prevRow{0};
-  auto consecutiveCells{0};
-  for (auto it = pattern.cbegin(); it != pattern.cend(); it++) {
-    auto col = it->col - minCol;
-    auto row = it->row - minRow;
-    if (it == pattern.cbegin()) {
-      prevCol = col - 1;
-      prevRow = row - 1;
-    }
-    auto columnsSkipped{col - prevCol};
-    auto rowsSkipped{row - prevRow};
-    if (rowsSkipped > 0 || columnsSkipped > 1) {
-      if (consecutiveCells > 0) {
-        if (consecutiveCells > 1) {
-          ostrm << consecutiveCells;
-        }
-        consecutiveCells = 0;
-        ostrm << f_aliveCellSymbol;
-      }
-      if (rowsSkipped > 0) {
-        if (it != pattern.cbegin()) {
-          if (rowsSkipped > 1) {
-            ostrm << rowsSkipped;
-          }
-          ostrm << f_nextRowSymbol;
-        }
-        columnsSkipped = col + 1;
-      }
-      if (columnsSkipped > 1) {
-        if (columnsSkipped > 2) {
-          ostrm << columnsSkipped - 1;
+  auto minCol{pattern.width()};
+  auto maxCol{std::size_t{0}};
+  auto minRow{pattern.height()};
+  auto maxRow{std::size_t{0}};
+  for (std::size_t row = 0; row < pattern.height(); row++) {
+    const auto *words{pattern.row(row)};
+    auto first{findRunEnd(words, 0, pattern.width(), false)};
+    if (first == pattern.width()) {
+      continue;
+    }
+    auto index{pattern.wordsPerRow() - 1};
+    while (words[index] == 0) {
+      index--;
+    }
+    auto last{index * Grid::bitsPerWord};
+    for (auto word{words[index]}; word > 1; word >>= 1) {
+      last++;
+    }
+    minCol = std::min(minCol, first);
+    maxCol = std::max(maxCol, last);
+    minRow = std::min(minRow, row);
+    maxRow = row;
+  }
+  // An empty pattern is still written, as a 0x0 one.
+  auto isEmpty{minRow > maxRow};
+  std::ofstream ostrm{path};
+  ostrm << f_commentSymbol << "N " << path.stem().string() << f_endOfLine;
+  ostrm << f_widthKey << " = " << (isEmpty ? 0 : maxCol - minCol + 1) << ", "
+        << f_heightKey << " = " << (isEmpty ? 0 : maxRow - minRow + 1) << ", "
+        << f_ruleKey << " = " << toString(rule) << f_endOfLine;
+  Writer writer{ostrm};
+  std::size_t skippedRows{0};
+  for (auto row = minRow; row <= maxRow; row++) {
+    const auto *words{pattern.row(row)};
+    auto col{minCol};
+    auto end{maxCol + 1};
+    while (col < end) {
+      auto alive{pattern.at(col, row)};
+      auto runEnd{findRunEnd(words, col, end, alive)};
+      // Dead cells at the end of a row are implied by the next '$'.
+      if (alive || runEnd < end) {
+        if (skippedRows > 0) {
+          writer.write(skippedRows, f_nextRowSymbol);
+          skippedRows = 0;
         }
-        ostrm << f_deadCellSymbol;
+        writer.write(runEnd - col,
+                     alive ? f_aliveCellSymbol : f_deadCellSymbol);
       }
+      col = runEnd;
+    }
+    skippedRows++;
+  }
+  writer.finish();
+  if (!ostrm.flush()) {
+    throw std::runtime_error{"cannot write " + path.string()};
+  }
+}
+
+// Accepts both the B/S notation (B3/S23) and the older S/B one (23/3), and
+// ignores any bounded grid suffix (B3/S23:T100,100).
+std::optional<Rule> parseRule(const std::string &rule) {
+  auto text{rule.substr(0, rule.find(f_ruleSuffixSeparator))};
+  std::transform(text.begin(), text.end(), text.begin(),
+                 [](unsigned char c) { return std::toupper(c); });
+  auto separator{text.find(f_ruleSeparator)};
+  if (separator == std::string::npos) {
+    return {};
+  }
+  auto first{text.substr(0, separator)};
+  auto second{text.substr(separator + 1)};
+  std::optional<std::uint16_t> birthMask;
+  std::optional<std::uint16_t> survivalMask;
+  if (!first.empty() && first.front() == f_birthSymbol && !second.empty() &&
+      second.front() == f_survivalSymbol) {
+    birthMask = parseRuleMask(first.substr(1));
+    survivalMask = parseRuleMask(second.substr(1));
+  } else {
+    survivalMask = parseRuleMask(first);
+    birthMask = parseRuleMask(second);
+  }
+  if (!birthMask || !survivalMask) {
+    return {};
+  }
+  return Rule{*birthMask, *survivalMask};
+}
+
+std::string toString(Rule rule) {
+  std::string text{f_birthSymbol};
+  for (auto count = 0; count <= f_maxNeighbourCount; count++) {
+    if ((rule.birthMask >> count) & 1) {
+      text.push_back(static_cast<char>('0' + count));
     }
-    consecutiveCells++;
-    prevRow = row;
-    prevCol = col;
   }
-  if (consecutiveCells > 0) {
-    if (consecutiveCells > 1) {
-      ostrm << consecutiveCells;
+  text.push_back(f_ruleSeparator);
+  text.push_back(f_survivalSymbol);
+  for (auto count = 0; count <= f_maxNeighbourCount; count++) {
+    if ((rule.survivalMask >> count) & 1) {
+      text.push_back(static_cast<char>('0' + count));
     }
-    ostrm << f_aliveCellSymbol;
   }
-  ostrm << f_endOfPatternSymbol << std::endl;
-  ostrm.close();
+  return text;
 }
 }  // namespace rle
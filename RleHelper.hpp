@@ -1,15 +1,61 @@
 #ifndef GAME_OF_LIFE_RLE_HELPER_HPP
 #define GAME_OF_LIFE_RLE_HELPER_HPP
 
-#include <set>
+#include <filesystem>
+#include <functional>
+#include <optional>
+#include <stdexcept>
 #include <string>
+#include <string_view>
 
-#include "Cell.hpp"
+#include "Grid.hpp"
+#include "HashLife.hpp"
+#include "Rule.hpp"
 
 namespace rle {
-std::set<std::string> listPatternNames();
-std::set<Cell> loadPattern(const std::string &name);
-void savePattern(const std::string &name, const std::set<Cell> &pattern);
+struct Pattern {
+  Grid cells;
+  std::optional<Rule> rule;
+};
+
+// Thrown for malformed input, with the 1-based position of the offending
+// character.
+class ParseError : public std::runtime_error {
+public:
+  ParseError(const std::string &message, std::size_t line, std::size_t column);
+
+  std::size_t line() const;
+  std::size_t column() const;
+
+private:
+  std::size_t m_line;
+  std::size_t m_column;
+};
+
+// Cancels the parse this was thrown from.
+class Cancelled : public std::runtime_error {
+public:
+  Cancelled();
+};
+
+// Called as parsing advances with the fraction of the input consumed so far.
+// Returning false cancels the parse by throwing Cancelled.
+using ProgressCallback = std::function<bool(float)>;
+
+std::filesystem::path patternsFolder();
+bool isPatternFile(const std::filesystem::path &path);
+std::filesystem::path patternPath(const std::string &name);
+Pattern parsePattern(std::string_view text,
+                     const ProgressCallback &progress = {});
+Pattern loadPatternFile(const std::filesystem::path &path,
+                        const ProgressCallback &progress = {});
+void savePattern(const std::string &name, const Grid &pattern, Rule rule);
+void savePatternFile(const std::filesystem::path &path, const Grid &pattern,
+                     Rule rule);
+void savePatternFile(const std::filesystem::path &path,
+                     const HashLife &pattern, Rule rule);
+std::optional<Rule> parseRule(const std::string &rule);
+std::string toString(Rule rule);
 }  // namespace rle
 
 #endif
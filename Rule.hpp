@@ -0,0 +1,29 @@
+#ifndef GAME_OF_LIFE_RULE_HPP
+#define GAME_OF_LIFE_RULE_HPP
+
+#include <cstdint>
+
+// Life-like rule as two 9-bit masks, where bit n is set if a cell with n alive
+// neighbours is born or survives.
+struct Rule {
+  std::uint16_t birthMask{0};
+  std::uint16_t survivalMask{0};
+
+  constexpr bool operator==(const Rule &other) const {
+    return birthMask == other.birthMask && survivalMask == other.survivalMask;
+  }
+  constexpr bool operator!=(const Rule &other) const {
+    return !(*this == other);
+  }
+};
+
+namespace rules {
+constexpr Rule conway{1 << 3, (1 << 2) | (1 << 3)};
+constexpr Rule highLife{(1 << 3) | (1 << 6), (1 << 2) | (1 << 3)};
+constexpr Rule dayAndNight{(1 << 3) | (1 << 6) | (1 << 7) | (1 << 8),
+                           (1 << 3) | (1 << 4) | (1 << 6) | (1 << 7) |
+                               (1 << 8)};
+constexpr Rule seeds{1 << 2, 0};
+} // namespace rules
+
+#endif
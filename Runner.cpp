@@ -0,0 +1,292 @@
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <limits>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "Checkpoint.hpp"
+#include "MacrocellHelper.hpp"
+#include "Model.hpp"
+#include "RleHelper.hpp"
+
+namespace {
+constexpr std::size_t f_defaultWidth{960};
+constexpr std::size_t f_defaultHeight{515};
+constexpr std::size_t f_maxLog2Jump{HashLife::maxLog2Generations};
+// Bounds on the grid and the thread count, well below what would wrap around
+// or fail to allocate.
+constexpr std::size_t f_maxGridCells{std::size_t{1} << 32};
+constexpr std::size_t f_maxDimension{std::size_t{1} << 20};
+constexpr std::size_t f_maxThreads{1024};
+
+enum class ExitCode {
+  Success,
+  InvalidArguments,
+  InvalidPattern,
+  OutputFailed
+};
+
+struct Options {
+  std::size_t width{f_defaultWidth};
+  std::size_t height{f_defaultHeight};
+  std::size_t generations{0};
+  std::size_t threads{0};
+  std::string patternPath;
+  std::string outputPath;
+  std::optional<double> soupDensity;
+  std::optional<std::uint64_t> seed;
+  std::optional<Rule> rule;
+  bool isUnbounded{false};
+  bool isHashLife{false};
+};
+
+void printUsage(const char *program) {
+  std::cerr
+      << "Usage: " << program << " --pattern PATH | --soup DENSITY [options]\n"
+      << "  --pattern PATH      RLE or macrocell pattern, centred on the grid\n"
+      << "                      or a .ckpt checkpoint to resume, which also\n"
+      << "                      sets the grid size\n"
+      << "  --soup DENSITY      random soup with exactly DENSITY times the\n"
+      << "                      grid size cells, instead of a pattern\n"
+      << "  --seed N            seed of the soup (default: random), printed\n"
+      << "                      so a soup can be generated again\n"
+      << "  --width N           grid width (default 960)\n"
+      << "  --height N          grid height (default 515)\n"
+      << "  --rule RULE         rule such as B3/S23, overriding the file's\n"
+      << "  --generations N     generations to run (default 0), skipping\n"
+      << "                      whole periods once the grid settles into\n"
+      << "                      a cycle\n"
+      << "  --output PATH       write the final grid as RLE, as a macrocell\n"
+      << "                      if PATH ends with .mc, or as a checkpoint\n"
+      << "                      if it ends with .ckpt, which is refused\n"
+      << "                      with --unbounded\n"
+      << "  --threads N         worker threads (default: all cores)\n"
+      << "  --unbounded         let patterns leave the grid\n"
+      << "  --hashlife          advance in power-of-two HashLife jumps\n";
+}
+
+// Parses a whole decimal number within the given bounds. Signs, spaces and
+// trailing characters are refused, as std::stoull takes "-1" and wraps it
+// around.
+std::uint64_t parseNumber(const char *text, std::uint64_t min,
+                          std::uint64_t max) {
+  std::size_t length{0};
+  if (std::isdigit(static_cast<unsigned char>(text[0])) == 0) {
+    throw std::invalid_argument{text};
+  }
+  auto number{std::stoull(text, &length)};
+  if (text[length] != '\0' || number < min || number > max) {
+    throw std::out_of_range{text};
+  }
+  return number;
+}
+
+std::optional<Options> parseOptions(int argc, char **argv) {
+  Options options;
+  try {
+    for (int i = 1; i < argc; i++) {
+      auto hasValue{i + 1 < argc};
+      if (std::strcmp(argv[i], "--unbounded") == 0) {
+        options.isUnbounded = true;
+      } else if (std::strcmp(argv[i], "--hashlife") == 0) {
+        options.isHashLife = true;
+      } else if (!hasValue) {
+        return {};
+      } else if (std::strcmp(argv[i], "--pattern") == 0) {
+        options.patternPath = argv[++i];
+      } else if (std::strcmp(argv[i], "--output") == 0) {
+        options.outputPath = argv[++i];
+      } else if (std::strcmp(argv[i], "--width") == 0) {
+        options.width = parseNumber(argv[++i], 1, f_maxDimension);
+      } else if (std::strcmp(argv[i], "--height") == 0) {
+        options.height = parseNumber(argv[++i], 1, f_maxDimension);
+      } else if (std::strcmp(argv[i], "--generations") == 0) {
+        options.generations =
+            parseNumber(argv[++i], 0, std::numeric_limits<std::size_t>::max());
+      } else if (std::strcmp(argv[i], "--soup") == 0) {
+        std::size_t length{0};
+        auto density{std::stod(argv[++i], &length)};
+        if (argv[i][length] != '\0' || !(density >= 0. && density <= 1.)) {
+          return {};
+        }
+        options.soupDensity = density;
+      } else if (std::strcmp(argv[i], "--seed") == 0) {
+        options.seed = parseNumber(argv[++i], 0,
+                                   std::numeric_limits<std::uint64_t>::max());
+      } else if (std::strcmp(argv[i], "--threads") == 0) {
+        options.threads = parseNumber(argv[++i], 1, f_maxThreads);
+      } else if (std::strcmp(argv[i], "--rule") == 0) {
+        options.rule = rle::parseRule(argv[++i]);
+        if (!options.rule) {
+          return {};
+        }
+      } else {
+        return {};
+      }
+    }
+  } catch (const std::logic_error &) {
+    return {};
+  }
+  if (options.patternPath.empty() == !options.soupDensity ||
+      options.height > f_maxGridCells / options.width) {
+    return {};
+  }
+  return options;
+}
+
+// Runs the generations as one HashLife jump per set bit of their count.
+void jump(Model &model, std::size_t generations) {
+  for (auto log2Generations = f_maxLog2Jump + 1; log2Generations-- > 0;) {
+    auto step{std::size_t{1} << log2Generations};
+    while (generations >= step) {
+      if (!model.jump(log2Generations)) {
+        for (; generations > 0; generations--) {
+          model.update();
+        }
+        return;
+      }
+      generations -= step;
+    }
+  }
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  auto options{parseOptions(argc, argv)};
+  if (!options) {
+    printUsage(argv[0]);
+    return static_cast<int>(ExitCode::InvalidArguments);
+  }
+  if (options->isUnbounded &&
+      checkpoint::isCheckpointFile(options->outputPath)) {
+    std::cerr << "Checkpoints only hold the grid, not the unbounded plane"
+              << std::endl;
+    return static_cast<int>(ExitCode::InvalidArguments);
+  }
+  if (options->isUnbounded && options->rule &&
+      (options->rule->birthMask & 1) != 0) {
+    std::cerr << "Rules with B0 cannot run unbounded" << std::endl;
+    return static_cast<int>(ExitCode::InvalidArguments);
+  }
+  if (!options->soupDensity &&
+      !std::filesystem::is_regular_file(options->patternPath)) {
+    std::cerr << "Cannot open " << options->patternPath << std::endl;
+    return static_cast<int>(ExitCode::InvalidPattern);
+  }
+  std::optional<Model> model;
+  try {
+    if (options->soupDensity) {
+      model.emplace(options->width, options->height);
+      if (options->threads > 0) {
+        model->setThreadCount(options->threads);
+      }
+      if (options->rule) {
+        model->setRule(options->rule.value());
+      }
+      model->setUnbounded(options->isUnbounded);
+      if (options->seed) {
+        model->generatePopulation(options->soupDensity.value(),
+                                  options->seed.value());
+      } else {
+        model->generatePopulation(options->soupDensity.value());
+      }
+    } else if (checkpoint::isCheckpointFile(options->patternPath)) {
+      auto snapshot{checkpoint::load(options->patternPath)};
+      model.emplace(snapshot.cells.width(), snapshot.cells.height());
+      if (options->threads > 0) {
+        model->setThreadCount(options->threads);
+      }
+      model->setUnbounded(options->isUnbounded);
+      model->restore(std::move(snapshot.cells),
+                     options->rule.value_or(snapshot.rule),
+                     snapshot.generation);
+    } else {
+      model.emplace(options->width, options->height);
+      std::optional<Model::StagedPattern> pattern;
+      std::optional<Rule> rule;
+      if (mc::isMacrocellFile(options->patternPath)) {
+        HashLife cells;
+        rule = mc::loadPatternFile(options->patternPath, cells);
+        if (cells.population() > 0) {
+          pattern = model->stagePattern(cells, options->isUnbounded);
+        }
+      } else {
+        auto cells{rle::loadPatternFile(options->patternPath)};
+        rule = cells.rule;
+        if (!cells.cells.empty()) {
+          pattern = model->stagePattern(cells.cells, options->isUnbounded);
+        }
+      }
+      if (!pattern) {
+        std::cerr << "No cells in " << options->patternPath << std::endl;
+        return static_cast<int>(ExitCode::InvalidPattern);
+      }
+      if (options->threads > 0) {
+        model->setThreadCount(options->threads);
+      }
+      if (auto ruleToApply{options->rule ? options->rule : rule}) {
+        model->setRule(ruleToApply.value());
+      }
+      model->setUnbounded(options->isUnbounded);
+      model->insertPattern(std::move(pattern.value()));
+    }
+  } catch (const std::bad_alloc &) {
+    std::cerr << "Not enough memory for the grid" << std::endl;
+    return static_cast<int>(ExitCode::InvalidArguments);
+  } catch (const std::exception &error) {
+    std::cerr << options->patternPath << ":" << error.what() << std::endl;
+    return static_cast<int>(ExitCode::InvalidPattern);
+  }
+  auto start{std::chrono::steady_clock::now()};
+  if (options->isHashLife) {
+    jump(model.value(), options->generations);
+  } else {
+    std::size_t generation{0};
+    for (; generation < options->generations && !model->cycle();
+         generation++) {
+      model->update();
+    }
+    model->fastForward(options->generations - generation);
+  }
+  std::chrono::duration<double> elapsed{std::chrono::steady_clock::now() -
+                                        start};
+  if (options->soupDensity) {
+    std::cout << "soup=" << options->soupDensity.value()
+              << " seed=" << model->populationSeed();
+  } else {
+    std::cout << "pattern=" << options->patternPath;
+  }
+  std::cout << " rule=" << rle::toString(model->rule())
+            << " generation=" << model->generation()
+            << " population=" << model->population();
+  if (auto cycle{model->cycle()}) {
+    std::cout << " period=" << cycle->period
+              << " cycleStart=" << cycle->startGeneration;
+  }
+  std::cout << " seconds=" << elapsed.count() << std::endl;
+  if (!options->outputPath.empty()) {
+    try {
+      if (checkpoint::isCheckpointFile(options->outputPath)) {
+        checkpoint::save(options->outputPath, model.value());
+      } else if (model->isUnbounded()) {
+        HashLife cells;
+        model->storeCells(cells);
+        rle::savePatternFile(options->outputPath, cells, model->rule());
+      } else {
+        rle::savePatternFile(options->outputPath, model->aliveCells(),
+                             model->rule());
+      }
+    } catch (const std::exception &error) {
+      std::cerr << options->outputPath << ":" << error.what() << std::endl;
+      return static_cast<int>(ExitCode::OutputFailed);
+    }
+  }
+  return static_cast<int>(ExitCode::Success);
+}
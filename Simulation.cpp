@@ -0,0 +1,254 @@
+#include "Simulation.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <utility>
+
+namespace {
+// Time between generations at speed one.
+constexpr auto f_updatePeriod{std::chrono::milliseconds{100}};
+// Longest the simulation thread runs between two published frames.
+constexpr auto f_frameBudget{std::chrono::milliseconds{16}};
+constexpr auto f_rateWindow{std::chrono::milliseconds{500}};
+constexpr std::uint8_t f_frameIndexMask{0x3};
+constexpr std::uint8_t f_newFrameFlag{0x4};
+
+Simulation::Frame makeFrame(const Model &model) {
+  return {model.status(),
+          model.speed(),
+          model.minSpeed(),
+          model.maxSpeed(),
+          model.generation(),
+          model.population(),
+          model.rule(),
+          model.cycle(),
+          model.isUnbounded(),
+          !model.initialPattern().empty(),
+          false,
+          0.,
+          model.aliveCells(),
+          model.visitedCells(),
+          {}};
+}
+
+// Copies the words of the stale tiles over the previous contents of the
+// grids, which are left as they are everywhere else.
+void copyTiles(const Model &model, Simulation::Frame &frame,
+               std::vector<std::uint8_t> &staleTiles) {
+  const auto &tiles{model.tiles()};
+  const auto &cells{model.aliveCells()};
+  const auto &visitedCells{model.visitedCells()};
+  for (std::size_t tileRow = 0; tileRow < tiles.rows(); tileRow++) {
+    auto firstRow{tileRow * TileMap::tileHeight};
+    auto lastRow{std::min(firstRow + TileMap::tileHeight, cells.height())};
+    for (std::size_t tileCol = 0; tileCol < tiles.columns(); tileCol++) {
+      auto &isStale{staleTiles[tileRow * tiles.columns() + tileCol]};
+      if (isStale == 0) {
+        continue;
+      }
+      for (auto row = firstRow; row < lastRow; row++) {
+        frame.cells.row(row)[tileCol] = cells.row(row)[tileCol];
+        frame.visitedCells.row(row)[tileCol] = visitedCells.row(row)[tileCol];
+      }
+      isStale = 0;
+    }
+  }
+}
+
+void capture(const Model &model, Simulation::Frame &frame,
+             std::vector<std::uint8_t> &staleTiles) {
+  frame.status = model.status();
+  frame.speed = model.speed();
+  frame.minSpeed = model.minSpeed();
+  frame.maxSpeed = model.maxSpeed();
+  frame.generation = model.generation();
+  frame.population = model.population();
+  frame.rule = model.rule();
+  frame.cycle = model.cycle();
+  frame.isUnbounded = model.isUnbounded();
+  frame.hasInitialPattern = !model.initialPattern().empty();
+  copyTiles(model, frame, staleTiles);
+}
+} // namespace
+
+std::optional<Cell> Simulation::Frame::cellAt(std::size_t col,
+                                              std::size_t row) const {
+  if (col >= cells.width() || row >= cells.height()) {
+    return {};
+  }
+  if (cells.at(col, row)) {
+    return Cell{col, row, Cell::Status::Alive};
+  }
+  return Cell{col, row,
+              visitedCells.at(col, row) ? Cell::Status::Dead
+                                        : Cell::Status::Empty};
+}
+
+Simulation::Simulation(Model &model)
+    : m_model{model},
+      m_frames{makeFrame(model), makeFrame(model), makeFrame(model)},
+      m_staleTiles{std::vector<std::uint8_t>(model.tileCount(), 0),
+                   std::vector<std::uint8_t>(model.tileCount(), 0),
+                   std::vector<std::uint8_t>(model.tileCount(), 0)},
+      m_frontFrame{0}, m_backFrame{1}, m_readyFrame{2}, m_mutex{},
+      m_commandPosted{}, m_commands{}, m_isTurbo{false}, m_isStopping{false},
+      m_error{}, m_nextUpdate{}, m_rateWindowStart{},
+      m_rateWindowGenerations{0}, m_generationRate{0},
+      m_worker{&Simulation::work, this} {}
+
+Simulation::~Simulation() {
+  {
+    std::lock_guard lock{m_mutex};
+    m_isStopping = true;
+  }
+  m_commandPosted.notify_one();
+  m_worker.join();
+}
+
+std::size_t Simulation::width() const { return m_model.width(); }
+
+std::size_t Simulation::height() const { return m_model.height(); }
+
+const Simulation::Frame &Simulation::frame() const {
+  return m_frames[m_frontFrame];
+}
+
+bool Simulation::acquireFrame() {
+  if ((m_readyFrame.load(std::memory_order_relaxed) & f_newFrameFlag) == 0) {
+    return false;
+  }
+  auto ready{m_readyFrame.exchange(static_cast<std::uint8_t>(m_frontFrame),
+                                   std::memory_order_acq_rel)};
+  m_frontFrame = ready & f_frameIndexMask;
+  return true;
+}
+
+void Simulation::post(Command command) {
+  {
+    std::lock_guard lock{m_mutex};
+    m_commands.push_back(std::move(command));
+  }
+  m_commandPosted.notify_one();
+}
+
+void Simulation::setTurbo(bool isTurbo) {
+  {
+    std::lock_guard lock{m_mutex};
+    m_isTurbo = isTurbo;
+  }
+  m_commandPosted.notify_one();
+}
+
+// Sleeps until a command arrives or, while the model runs, the next
+// generation is due, and publishes a frame after every wake-up that changed
+// anything. In turbo mode a running model never sleeps.
+void Simulation::work() {
+  std::vector<Command> commands;
+  auto isTurbo{false};
+  while (true) {
+    auto wasRunning{m_model.status() == Model::Status::Running};
+    auto wasTurbo{isTurbo};
+    {
+      std::unique_lock lock{m_mutex};
+      auto isWoken{[this, isTurbo]() {
+        return m_isStopping || !m_commands.empty() || m_isTurbo != isTurbo;
+      }};
+      if (!wasRunning) {
+        m_commandPosted.wait(lock, isWoken);
+      } else if (!isTurbo) {
+        m_commandPosted.wait_until(lock, m_nextUpdate, isWoken);
+      }
+      if (m_isStopping) {
+        return;
+      }
+      std::swap(commands, m_commands);
+      isTurbo = m_isTurbo;
+    }
+    if (!commands.empty()) {
+      m_error.clear();
+    }
+    for (auto &command : commands) {
+      try {
+        command(m_model);
+      } catch (const std::exception &error) {
+        m_error = error.what();
+      }
+    }
+    auto isChanged{!commands.empty() || isTurbo != wasTurbo};
+    commands.clear();
+    isChanged |= advance(wasRunning, isTurbo);
+    if (isChanged) {
+      publish(isTurbo);
+    }
+  }
+}
+
+// Runs the generations that are due, stopping early once the frame budget is
+// spent, and returns whether any ran. A schedule that falls more than a frame
+// behind is dropped rather than caught up.
+bool Simulation::advance(bool wasRunning, bool isTurbo) {
+  if (m_model.status() != Model::Status::Running) {
+    return false;
+  }
+  auto now{Clock::now()};
+  if (!wasRunning) {
+    m_nextUpdate = now;
+    m_rateWindowStart = now;
+    m_rateWindowGenerations = 0;
+    m_generationRate = 0;
+  }
+  auto deadline{now + f_frameBudget};
+  auto period{Clock::duration{f_updatePeriod} /
+              static_cast<Clock::rep>(m_model.speed())};
+  std::size_t generations{0};
+  while (m_model.status() == Model::Status::Running &&
+         (isTurbo || m_nextUpdate <= now) && now < deadline) {
+    m_model.update();
+    generations++;
+    m_nextUpdate += period;
+    now = Clock::now();
+  }
+  if (isTurbo || now - m_nextUpdate > f_frameBudget) {
+    m_nextUpdate = now;
+  }
+  measureRate(generations);
+  return generations > 0;
+}
+
+void Simulation::measureRate(std::size_t generations) {
+  m_rateWindowGenerations += generations;
+  auto now{Clock::now()};
+  std::chrono::duration<double> elapsed{now - m_rateWindowStart};
+  if (elapsed < f_rateWindow) {
+    return;
+  }
+  m_generationRate =
+      static_cast<double>(m_rateWindowGenerations) / elapsed.count();
+  m_rateWindowStart = now;
+  m_rateWindowGenerations = 0;
+}
+
+void Simulation::publish(bool isTurbo) {
+  const auto &tiles{m_model.tiles()};
+  for (std::size_t tileRow = 0; tileRow < tiles.rows(); tileRow++) {
+    for (std::size_t tileCol = 0; tileCol < tiles.columns(); tileCol++) {
+      if (tiles.isDirty(tileCol, tileRow)) {
+        for (auto &staleTiles : m_staleTiles) {
+          staleTiles[tileRow * tiles.columns() + tileCol] = 1;
+        }
+      }
+    }
+  }
+  m_model.clearDirtyTiles();
+  auto &frame{m_frames[m_backFrame]};
+  capture(m_model, frame, m_staleTiles[m_backFrame]);
+  frame.isTurbo = isTurbo;
+  frame.error = m_error;
+  frame.generationRate =
+      frame.status == Model::Status::Running ? m_generationRate : 0.;
+  auto ready{m_readyFrame.exchange(
+      static_cast<std::uint8_t>(m_backFrame | f_newFrameFlag),
+      std::memory_order_acq_rel)};
+  m_backFrame = ready & f_frameIndexMask;
+}
@@ -0,0 +1,107 @@
+#ifndef GAME_OF_LIFE_SIMULATION_HPP
+#define GAME_OF_LIFE_SIMULATION_HPP
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Cell.hpp"
+#include "Grid.hpp"
+#include "Model.hpp"
+#include "Rule.hpp"
+
+// Runs a model on a thread of its own. Edits reach the model as commands
+// through a queue, and after every change the thread publishes a frame, a copy
+// of everything there is to draw, so rendering and simulation never wait on
+// each other. A command that throws is reported in the frames rather than
+// ending the thread. Frames rotate through three buffers swapped with a single
+// atomic exchange: one being written, one being read and the newest one in
+// between. Each buffer remembers the tiles that changed since it was last
+// written, and only their words are copied into it. A running model advances
+// on a fixed timestep set by its speed, as many generations per frame as are
+// due, or in turbo mode as many as fit in the frame budget.
+class Simulation {
+public:
+  using Command = std::function<void(Model &)>;
+
+  struct Frame {
+    Model::Status status;
+    std::size_t speed;
+    std::size_t minSpeed;
+    std::size_t maxSpeed;
+    std::size_t generation;
+    std::size_t population;
+    Rule rule;
+    std::optional<Model::Cycle> cycle;
+    bool isUnbounded;
+    bool hasInitialPattern;
+    bool isTurbo;
+    // Generations per second over the last measurement window.
+    double generationRate;
+    Grid cells;
+    Grid visitedCells;
+    // Message of the last command that failed, kept until the next commands
+    // run.
+    std::string error;
+
+    std::optional<Cell> cellAt(std::size_t col, std::size_t row) const;
+  };
+
+  // The model must outlive the simulation and, once it has started, only be
+  // touched through commands.
+  explicit Simulation(Model &model);
+  ~Simulation();
+
+  Simulation(const Simulation &) = delete;
+  Simulation &operator=(const Simulation &) = delete;
+
+  std::size_t width() const;
+  std::size_t height() const;
+  // Frame taken by the last call to acquireFrame().
+  const Frame &frame() const;
+
+  // Takes the newest published frame, if there is one, and returns whether it
+  // did. The previous frame is handed back to the simulation thread.
+  bool acquireFrame();
+  void post(Command command);
+  void setTurbo(bool isTurbo);
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  void work();
+  bool advance(bool wasRunning, bool isTurbo);
+  void measureRate(std::size_t generations);
+  void publish(bool isTurbo);
+
+  Model &m_model;
+  std::array<Frame, 3> m_frames;
+  // Tiles of each frame that no longer match the model.
+  std::array<std::vector<std::uint8_t>, 3> m_staleTiles;
+  std::size_t m_frontFrame;
+  std::size_t m_backFrame;
+  // Index of the newest frame, flagged while the reader has not taken it.
+  std::atomic<std::uint8_t> m_readyFrame;
+  std::mutex m_mutex;
+  std::condition_variable m_commandPosted;
+  std::vector<Command> m_commands;
+  bool m_isTurbo;
+  bool m_isStopping;
+  std::string m_error;
+  Clock::time_point m_nextUpdate;
+  Clock::time_point m_rateWindowStart;
+  std::size_t m_rateWindowGenerations;
+  double m_generationRate;
+  std::thread m_worker;
+};
+
+#endif
@@ -0,0 +1,313 @@
+#include "SparseLife.hpp"
+
+#include <algorithm>
+#include <bitset>
+#include <stdexcept>
+
+#include "KernelSimd.hpp"
+
+namespace {
+using Word = Grid::Word;
+using Coord = SparseLife::Coord;
+
+constexpr std::uint32_t f_noChunk{0xffffffff};
+constexpr std::uint32_t f_maxIdleGenerations{8};
+constexpr Coord f_chunkSize{SparseLife::chunkSize};
+constexpr std::size_t f_lastIndex{SparseLife::chunkSize - 1};
+constexpr std::size_t f_paddedWidth{3};
+constexpr std::size_t f_westNeighbour{3};
+constexpr std::size_t f_eastNeighbour{4};
+constexpr std::uint64_t f_hashMultiplier{0x9e3779b97f4a7c15};
+// Neighbours are listed row by row, so the opposite of neighbour n is 7 - n.
+constexpr Coord f_neighbourCols[]{-1, 0, 1, -1, 1, -1, 0, 1};
+constexpr Coord f_neighbourRows[]{-1, -1, -1, 0, 0, 1, 1, 1};
+constexpr std::size_t f_oppositeSum{7};
+
+static_assert(SparseLife::chunkSize == Grid::bitsPerWord,
+              "chunks are one word wide");
+
+inline Coord toChunk(Coord cell) {
+  return cell >= 0 ? cell / f_chunkSize : -((-(cell + 1)) / f_chunkSize) - 1;
+}
+
+inline std::size_t toOffset(Coord cell) {
+  return static_cast<std::size_t>(cell - toChunk(cell) * f_chunkSize);
+}
+
+inline auto countCells(Word word) {
+  return static_cast<std::ptrdiff_t>(
+      std::bitset<Grid::bitsPerWord>{word}.count());
+}
+} // namespace
+
+bool SparseLife::Key::operator==(const Key &other) const {
+  return col == other.col && row == other.row;
+}
+
+std::size_t SparseLife::KeyHash::operator()(const Key &key) const {
+  auto hash{static_cast<std::uint64_t>(key.col) * f_hashMultiplier ^
+            static_cast<std::uint64_t>(key.row)};
+  hash *= f_hashMultiplier;
+  return static_cast<std::size_t>(hash ^ (hash >> 32));
+}
+
+SparseLife::SparseLife()
+    : m_chunks{}, m_index{}, m_population{0}, m_rule{rules::conway},
+      m_evolveRow{selectRowFunction<ScalarOps>(m_rule)} {}
+
+std::uint64_t SparseLife::population() const { return m_population; }
+
+std::size_t SparseLife::chunkCount() const { return m_chunks.size(); }
+
+std::size_t SparseLife::memoryUsage() const {
+  return m_chunks.capacity() * sizeof(Chunk) +
+         m_index.size() * (sizeof(Key) + sizeof(ChunkId) + sizeof(void *)) +
+         m_index.bucket_count() * sizeof(void *);
+}
+
+bool SparseLife::at(Coord col, Coord row) const {
+  auto id{find({toChunk(col), toChunk(row)})};
+  if (id == f_noChunk) {
+    return false;
+  }
+  return (m_chunks[id].cells[toOffset(row)] >> toOffset(col)) & 1;
+}
+
+void SparseLife::forEachChunk(const ChunkVisitor &visit) const {
+  for (const auto &chunk : m_chunks) {
+    if (std::any_of(chunk.cells.cbegin(), chunk.cells.cend(),
+                    [](auto word) { return word != 0; })) {
+      visit(chunk.key.col * f_chunkSize, chunk.key.row * f_chunkSize,
+            chunk.cells.data());
+    }
+  }
+}
+
+void SparseLife::store(Grid &cells) const {
+  auto words{static_cast<Coord>(cells.wordsPerRow())};
+  auto height{static_cast<Coord>(cells.height())};
+  for (const auto &chunk : m_chunks) {
+    if (chunk.key.col < 0 || chunk.key.col >= words || chunk.key.row < 0 ||
+        chunk.key.row * f_chunkSize >= height) {
+      continue;
+    }
+    auto mask{chunk.key.col + 1 == words ? cells.lastWordMask() : ~Word{0}};
+    auto firstRow{chunk.key.row * f_chunkSize};
+    auto lastRow{std::min(firstRow + f_chunkSize, height)};
+    for (auto row = firstRow; row < lastRow; row++) {
+      cells.row(static_cast<std::size_t>(row))[chunk.key.col] |=
+          chunk.cells[static_cast<std::size_t>(row - firstRow)] & mask;
+    }
+  }
+}
+
+void SparseLife::setRule(Rule rule) {
+  if ((rule.birthMask & 1) != 0) {
+    throw std::invalid_argument{"rules with B0 cannot run unbounded"};
+  }
+  if (rule == m_rule) {
+    return;
+  }
+  m_rule = rule;
+  m_evolveRow = selectRowFunction<ScalarOps>(rule);
+  for (auto &chunk : m_chunks) {
+    chunk.isChanged = true;
+  }
+}
+
+void SparseLife::set(Coord col, Coord row, bool alive) {
+  Key key{toChunk(col), toChunk(row)};
+  auto id{find(key)};
+  if (id == f_noChunk) {
+    if (!alive) {
+      return;
+    }
+    id = insert(key);
+  }
+  auto &chunk{m_chunks[id]};
+  auto &word{chunk.cells[toOffset(row)]};
+  auto bit{Word{1} << toOffset(col)};
+  if (((word & bit) != 0) == alive) {
+    return;
+  }
+  word ^= bit;
+  m_population = alive ? m_population + 1 : m_population - 1;
+  chunk.isChanged = true;
+}
+
+void SparseLife::load(const Grid &cells) {
+  clear();
+  for (std::size_t row = 0; row < cells.height(); row++) {
+    const auto *words{cells.row(row)};
+    for (std::size_t word = 0; word < cells.wordsPerRow(); word++) {
+      if (words[word] == 0) {
+        continue;
+      }
+      Key key{static_cast<Coord>(word),
+              static_cast<Coord>(row / chunkSize)};
+      auto id{find(key)};
+      if (id == f_noChunk) {
+        id = insert(key);
+      }
+      m_chunks[id].cells[row % chunkSize] = words[word];
+      m_chunks[id].isChanged = true;
+      m_population += static_cast<std::uint64_t>(countCells(words[word]));
+    }
+  }
+}
+
+void SparseLife::clear() {
+  m_chunks.clear();
+  m_index.clear();
+  m_population = 0;
+}
+
+void SparseLife::step() {
+  auto chunkCount{static_cast<ChunkId>(m_chunks.size())};
+  for (ChunkId id = 0; id < chunkCount; id++) {
+    if (m_chunks[id].isChanged) {
+      grow(id);
+    }
+  }
+  std::vector<ChunkId> activeChunks;
+  for (ChunkId id = 0; id < m_chunks.size(); id++) {
+    if (isActive(id)) {
+      activeChunks.push_back(id);
+    }
+  }
+  std::ptrdiff_t populationChange{0};
+  for (auto id : activeChunks) {
+    populationChange += evolveChunk(id);
+  }
+  for (auto id : activeChunks) {
+    auto &chunk{m_chunks[id]};
+    chunk.isChanged = chunk.cells != chunk.nextCells;
+    chunk.cells = chunk.nextCells;
+  }
+  m_population = static_cast<std::uint64_t>(
+      static_cast<std::ptrdiff_t>(m_population) + populationChange);
+  for (auto id = static_cast<ChunkId>(m_chunks.size()); id-- > 0;) {
+    auto &chunk{m_chunks[id]};
+    auto isEmpty{std::all_of(chunk.cells.cbegin(), chunk.cells.cend(),
+                             [](auto word) { return word == 0; })};
+    chunk.idleGenerations =
+        isEmpty && !chunk.isChanged ? chunk.idleGenerations + 1 : 0;
+    if (chunk.idleGenerations > f_maxIdleGenerations) {
+      erase(id);
+    }
+  }
+}
+
+SparseLife::ChunkId SparseLife::find(Key key) const {
+  auto it{m_index.find(key)};
+  return it == m_index.end() ? f_noChunk : it->second;
+}
+
+SparseLife::ChunkId SparseLife::insert(Key key) {
+  auto id{static_cast<ChunkId>(m_chunks.size())};
+  Chunk chunk{key, {}, {}, {}, 0, false};
+  chunk.neighbours.fill(f_noChunk);
+  for (std::size_t neighbour = 0; neighbour < neighbourCount; neighbour++) {
+    auto other{find({key.col + f_neighbourCols[neighbour],
+                     key.row + f_neighbourRows[neighbour]})};
+    if (other != f_noChunk) {
+      chunk.neighbours[neighbour] = other;
+      m_chunks[other].neighbours[f_oppositeSum - neighbour] = id;
+    }
+  }
+  m_chunks.push_back(chunk);
+  m_index.emplace(key, id);
+  return id;
+}
+
+void SparseLife::erase(ChunkId id) {
+  for (std::size_t neighbour = 0; neighbour < neighbourCount; neighbour++) {
+    auto other{m_chunks[id].neighbours[neighbour]};
+    if (other != f_noChunk) {
+      m_chunks[other].neighbours[f_oppositeSum - neighbour] = f_noChunk;
+    }
+  }
+  m_index.erase(m_chunks[id].key);
+  auto last{static_cast<ChunkId>(m_chunks.size() - 1)};
+  if (id != last) {
+    m_chunks[id] = m_chunks[last];
+    for (std::size_t neighbour = 0; neighbour < neighbourCount; neighbour++) {
+      auto other{m_chunks[id].neighbours[neighbour]};
+      if (other != f_noChunk) {
+        m_chunks[other].neighbours[f_oppositeSum - neighbour] = id;
+      }
+    }
+    m_index[m_chunks[id].key] = id;
+  }
+  m_chunks.pop_back();
+}
+
+// Allocates the neighbours that live cells on the borders of a chunk can
+// reach in the next generation.
+void SparseLife::grow(ChunkId id) {
+  const auto &cells{m_chunks[id].cells};
+  Word westColumn{0};
+  Word eastColumn{0};
+  for (auto word : cells) {
+    westColumn |= word & 1;
+    eastColumn |= word >> f_lastIndex;
+  }
+  auto top{cells[0]};
+  auto bottom{cells[f_lastIndex]};
+  bool isReached[neighbourCount]{(top & 1) != 0,
+                                 top != 0,
+                                 (top >> f_lastIndex) != 0,
+                                 westColumn != 0,
+                                 eastColumn != 0,
+                                 (bottom & 1) != 0,
+                                 bottom != 0,
+                                 (bottom >> f_lastIndex) != 0};
+  for (std::size_t neighbour = 0; neighbour < neighbourCount; neighbour++) {
+    if (isReached[neighbour] &&
+        m_chunks[id].neighbours[neighbour] == f_noChunk) {
+      auto key{m_chunks[id].key};
+      insert({key.col + f_neighbourCols[neighbour],
+              key.row + f_neighbourRows[neighbour]});
+    }
+  }
+}
+
+bool SparseLife::isActive(ChunkId id) const {
+  const auto &chunk{m_chunks[id]};
+  return chunk.isChanged ||
+         std::any_of(chunk.neighbours.cbegin(), chunk.neighbours.cend(),
+                     [this](auto other) {
+                       return other != f_noChunk && m_chunks[other].isChanged;
+                     });
+}
+
+// Copies the chunk and the bordering rows and columns of its neighbours into a
+// padded three-word-wide block, so the generic word kernel can evolve it.
+std::ptrdiff_t SparseLife::evolveChunk(ChunkId id) {
+  auto &chunk{m_chunks[id]};
+  auto rowOf{[this, &chunk](std::size_t neighbour, std::size_t row) {
+    auto other{chunk.neighbours[neighbour]};
+    return other == f_noChunk ? Word{0} : m_chunks[other].cells[row];
+  }};
+  std::array<Word, (chunkSize + 2) * f_paddedWidth> block{};
+  for (std::size_t col = 0; col < f_paddedWidth; col++) {
+    block[col] = rowOf(col, f_lastIndex);
+    block[(chunkSize + 1) * f_paddedWidth + col] =
+        rowOf(neighbourCount - f_paddedWidth + col, 0);
+  }
+  for (std::size_t row = 0; row < chunkSize; row++) {
+    auto *padded{block.data() + (row + 1) * f_paddedWidth};
+    padded[0] = rowOf(f_westNeighbour, row);
+    padded[1] = chunk.cells[row];
+    padded[2] = rowOf(f_eastNeighbour, row);
+  }
+  std::ptrdiff_t populationChange{0};
+  for (std::size_t row = 0; row < chunkSize; row++) {
+    const auto *middle{block.data() + (row + 1) * f_paddedWidth + 1};
+    m_evolveRow(middle - f_paddedWidth, middle, middle + f_paddedWidth,
+                &chunk.nextCells[row], 1, m_rule);
+    populationChange +=
+        countCells(chunk.nextCells[row]) - countCells(chunk.cells[row]);
+  }
+  return populationChange;
+}
@@ -0,0 +1,85 @@
+#ifndef GAME_OF_LIFE_SPARSE_LIFE_HPP
+#define GAME_OF_LIFE_SPARSE_LIFE_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+#include "Grid.hpp"
+#include "Kernel.hpp"
+#include "Rule.hpp"
+
+// Unbounded plane stored as a hash map of 64x64 bit-packed chunks addressed by
+// signed 64-bit coordinates. Only chunks holding live cells, or bordering
+// chunks that do, are allocated, and only chunks whose neighbourhood changed
+// in the last generation are evolved. Every chunk caches the indices of its
+// eight neighbours so the kernel never goes through the hash map.
+class SparseLife {
+public:
+  using Coord = std::int64_t;
+  using ChunkVisitor =
+      std::function<void(Coord col, Coord row, const Grid::Word *words)>;
+
+  static constexpr std::size_t chunkSize{64};
+
+  SparseLife();
+
+  std::uint64_t population() const;
+  std::size_t chunkCount() const;
+  std::size_t memoryUsage() const;
+  bool at(Coord col, Coord row) const;
+  void forEachChunk(const ChunkVisitor &visit) const;
+  void store(Grid &cells) const;
+
+  // Throws std::invalid_argument for rules with B0, which would turn on the
+  // whole plane.
+  void setRule(Rule rule);
+  void set(Coord col, Coord row, bool alive);
+  void load(const Grid &cells);
+  void clear();
+  void step();
+
+private:
+  using ChunkId = std::uint32_t;
+  using Rows = std::array<Grid::Word, chunkSize>;
+
+  static constexpr std::size_t neighbourCount{8};
+
+  struct Key {
+    Coord col;
+    Coord row;
+
+    bool operator==(const Key &other) const;
+  };
+
+  struct KeyHash {
+    std::size_t operator()(const Key &key) const;
+  };
+
+  struct Chunk {
+    Key key;
+    Rows cells;
+    Rows nextCells;
+    std::array<ChunkId, neighbourCount> neighbours;
+    std::uint32_t idleGenerations;
+    bool isChanged;
+  };
+
+  ChunkId find(Key key) const;
+  ChunkId insert(Key key);
+  void erase(ChunkId id);
+  void grow(ChunkId id);
+  bool isActive(ChunkId id) const;
+  std::ptrdiff_t evolveChunk(ChunkId id);
+
+  std::vector<Chunk> m_chunks;
+  std::unordered_map<Key, ChunkId, KeyHash> m_index;
+  std::uint64_t m_population;
+  Rule m_rule;
+  kernel::RowFunction m_evolveRow;
+};
+
+#endif
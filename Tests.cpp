@@ -0,0 +1,455 @@
+#include <algorithm>
+#include <cmath>
+#include <exception>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "Checkpoint.hpp"
+#include "Kernel.hpp"
+#include "Model.hpp"
+#include "RleHelper.hpp"
+#include "Simulation.hpp"
+
+namespace {
+// Not a multiple of the word size, so the last word of every row is partial.
+constexpr std::size_t f_width{300};
+constexpr std::size_t f_height{100};
+constexpr std::uint32_t f_seed{20240601};
+constexpr double f_density{.3};
+constexpr std::size_t f_kernelGenerations{24};
+constexpr std::size_t f_historyMemoryLimit{64 << 20};
+// Room for a few copies of the grid, so older changes get evicted.
+constexpr std::size_t f_smallHistoryMemoryLimit{32 << 10};
+// More than three, so every frame buffer is written over a few times.
+constexpr std::size_t f_frameRounds{12};
+
+// Includes a B0 rule without S8, under which the grid flips every generation.
+const std::vector<Rule> f_rules{rules::conway,
+                                rules::highLife,
+                                rules::dayAndNight,
+                                rules::seeds,
+                                {(1 << 1) | (1 << 3) | (1 << 5) | (1 << 7),
+                                 (1 << 1) | (1 << 3) | (1 << 5) | (1 << 7)},
+                                {(1 << 0) | (1 << 2), 1 << 1}};
+
+const std::vector<std::string> f_glider{".O.", "..O", "OOO"};
+const std::vector<std::string> f_blinker{"OOO"};
+
+struct Test {
+  std::string name;
+  std::function<bool()> run;
+};
+
+bool expect(bool condition, const std::string &description) {
+  if (!condition) {
+    std::cerr << "  failed: " << description << std::endl;
+  }
+  return condition;
+}
+
+bool isEqual(const Grid &left, const Grid &right) {
+  if (left.width() != right.width() || left.height() != right.height()) {
+    return false;
+  }
+  for (std::size_t row = 0; row < left.height(); row++) {
+    for (std::size_t col = 0; col < left.width(); col++) {
+      if (left.at(col, row) != right.at(col, row)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// Random cells, with the corners alive so the pattern spans the whole grid.
+Grid randomGrid(std::size_t width, std::size_t height, std::uint32_t seed) {
+  std::mt19937 random{seed};
+  std::bernoulli_distribution isAlive{f_density};
+  Grid grid{width, height};
+  for (std::size_t row = 0; row < height; row++) {
+    for (std::size_t col = 0; col < width; col++) {
+      grid.set(col, row, isAlive(random));
+    }
+  }
+  grid.set(0, 0, true);
+  grid.set(width - 1, height - 1, true);
+  return grid;
+}
+
+Grid placedGrid(const std::vector<std::string> &pattern, std::size_t width,
+                std::size_t height) {
+  Grid grid{width, height};
+  auto top{(height - pattern.size()) / 2};
+  auto left{(width - pattern.front().size()) / 2};
+  for (std::size_t row = 0; row < pattern.size(); row++) {
+    for (std::size_t col = 0; col < pattern[row].size(); col++) {
+      grid.set(left + col, top + row, pattern[row][col] == 'O');
+    }
+  }
+  return grid;
+}
+
+// Cell by cell generation, with every cell outside the grid dead.
+Grid referenceStep(const Grid &cells, Rule rule) {
+  Grid next{cells.width(), cells.height()};
+  for (std::size_t row = 0; row < cells.height(); row++) {
+    for (std::size_t col = 0; col < cells.width(); col++) {
+      auto count{0u};
+      for (auto r = std::max<std::size_t>(row, 1) - 1;
+           r <= std::min(row + 1, cells.height() - 1); r++) {
+        for (auto c = std::max<std::size_t>(col, 1) - 1;
+             c <= std::min(col + 1, cells.width() - 1); c++) {
+          count += (r != row || c != col) && cells.at(c, r) ? 1 : 0;
+        }
+      }
+      auto mask{cells.at(col, row) ? rule.survivalMask : rule.birthMask};
+      next.set(col, row, ((mask >> count) & 1) != 0);
+    }
+  }
+  return next;
+}
+
+// Steps the model on the given instruction set, split across a few threads,
+// and compares every generation with the reference.
+bool testKernel(kernel::Isa isa) {
+  if (!kernel::isSupported(isa)) {
+    std::cout << "  skipped: " << kernel::toString(isa) << " not supported"
+              << std::endl;
+    return true;
+  }
+  auto defaultIsa{kernel::isa()};
+  kernel::setIsa(isa);
+  auto isPassing{true};
+  for (std::size_t index = 0; index < f_rules.size(); index++) {
+    auto rule{f_rules[index]};
+    auto expected{randomGrid(f_width, f_height, f_seed)};
+    Model model{f_width, f_height};
+    model.setThreadCount(3);
+    model.restore(Grid{expected}, rule, 0);
+    for (std::size_t generation = 1; generation <= f_kernelGenerations;
+         generation++) {
+      expected = referenceStep(expected, rule);
+      model.update();
+      if (!isEqual(model.aliveCells(), expected) ||
+          model.population() != expected.population()) {
+        isPassing = expect(false, rle::toString(rule) + " generation " +
+                                      std::to_string(generation));
+        break;
+      }
+    }
+  }
+  kernel::setIsa(defaultIsa);
+  return isPassing;
+}
+
+std::filesystem::path temporaryPath(const std::string &name) {
+  auto folder{std::filesystem::temp_directory_path() / "game-of-life-tests"};
+  std::filesystem::create_directories(folder);
+  return folder / name;
+}
+
+// Saves a grid spanning its whole size and reads it back through the
+// format picked by the extension.
+bool testPatternRoundTrip(const std::string &name) {
+  auto path{temporaryPath(name)};
+  auto isPassing{true};
+  for (auto rule : f_rules) {
+    auto cells{randomGrid(f_width, f_height, f_seed)};
+    rle::savePatternFile(path, cells, rule);
+    auto pattern{rle::loadPatternFile(path)};
+    isPassing &= expect(isEqual(pattern.cells, cells),
+                        name + " cells with " + rle::toString(rule));
+    isPassing &= expect(pattern.rule == rule, name + " rule");
+  }
+  rle::savePatternFile(path, Grid{f_width, f_height}, rules::conway);
+  isPassing &= expect(std::filesystem::exists(path), name + " empty file");
+  isPassing &= expect(rle::loadPatternFile(path).cells.population() == 0,
+                      name + " empty pattern");
+  std::filesystem::remove(path);
+  return isPassing;
+}
+
+bool isRejected(std::string_view text) {
+  try {
+    rle::parsePattern(text);
+  } catch (const rle::ParseError &) {
+    return true;
+  }
+  return false;
+}
+
+// Headers and runs that are read as they are written by other programs, and
+// runs that would wrap around or leave the grid.
+bool testRleParsing() {
+  auto isPassing{true};
+  auto pattern{rle::parsePattern("x = 3, y = 1, rule = B3/S23:T100,100\n3o!")};
+  isPassing &= expect(pattern.cells.population() == 3 &&
+                          pattern.rule == rules::conway,
+                      "rule with a bounded grid suffix");
+  pattern = rle::parsePattern("x = 3, y = 1, rule = 23/36\r\n3o!");
+  isPassing &= expect(pattern.rule == rules::highLife, "S/B rule");
+  isPassing &= expect(isRejected("x = 3, y = 1\n18446744073709551619o!"),
+                      "run count wrapping around");
+  isPassing &= expect(isRejected("x = 3, y = 1\n18446744073709551615b3o!"),
+                      "dead run wrapping the column around");
+  isPassing &= expect(isRejected("x = 3, y = 2\n18446744073709551615$3o!"),
+                      "row run wrapping the row around");
+  isPassing &= expect(isRejected("x = 3, y = 1\n4b!"), "dead run too long");
+  return isPassing;
+}
+
+bool testCheckpointRoundTrip() {
+  auto path{temporaryPath("round-trip.ckpt")};
+  Model model{f_width, f_height};
+  model.setRule(rules::highLife);
+  model.generatePopulation(f_density, f_seed);
+  for (auto generation = 0; generation < 10; generation++) {
+    model.update();
+  }
+  checkpoint::save(path, model);
+  auto summary{checkpoint::loadSummary(path)};
+  auto snapshot{checkpoint::load(path)};
+  std::filesystem::remove(path);
+  auto isPassing{true};
+  isPassing &= expect(isEqual(snapshot.cells, model.aliveCells()), "cells");
+  isPassing &= expect(snapshot.rule == model.rule(), "rule");
+  isPassing &= expect(snapshot.generation == model.generation(), "generation");
+  isPassing &= expect(snapshot.population == model.population(), "population");
+  isPassing &= expect(summary.width == f_width && summary.height == f_height &&
+                          summary.rule == snapshot.rule &&
+                          summary.generation == snapshot.generation &&
+                          summary.population == snapshot.population,
+                      "summary");
+  return isPassing;
+}
+
+// Rewinds past both kept changes and evicted ones, which are re-simulated
+// from the nearest copy of the grid.
+bool testRewind(std::size_t historyMemoryLimit) {
+  Model model{f_width, f_height};
+  model.setHistoryMemoryLimit(historyMemoryLimit);
+  model.generatePopulation(f_density, f_seed);
+  for (auto generation = 0; generation < 150; generation++) {
+    model.update();
+  }
+  auto isPassing{true};
+  for (auto generations : {1, 10, 80}) {
+    model.rewind(static_cast<std::size_t>(generations));
+    Model expected{f_width, f_height};
+    expected.generatePopulation(f_density, f_seed);
+    while (expected.generation() < model.generation()) {
+      expected.update();
+    }
+    isPassing &= expect(isEqual(model.aliveCells(), expected.aliveCells()) &&
+                            model.population() == expected.population(),
+                        "rewound to generation " +
+                            std::to_string(model.generation()));
+  }
+  isPassing &= expect(model.generation() == 59, "rewound 91 generations");
+  return isPassing;
+}
+
+bool testSoup() {
+  Model model{f_width, f_height};
+  model.setThreadCount(1);
+  model.generatePopulation(f_density, f_seed);
+  Model sameSeed{f_width, f_height};
+  sameSeed.setThreadCount(3);
+  sameSeed.generatePopulation(f_density, f_seed);
+  Model otherSeed{f_width, f_height};
+  otherSeed.generatePopulation(f_density, f_seed + 1);
+  auto expectedPopulation{static_cast<std::size_t>(
+      std::llround(f_density * static_cast<double>(f_width * f_height)))};
+  auto isPassing{true};
+  isPassing &= expect(isEqual(model.aliveCells(), sameSeed.aliveCells()),
+                      "same seed, other thread count");
+  isPassing &= expect(!isEqual(model.aliveCells(), otherSeed.aliveCells()),
+                      "other seed");
+  isPassing &= expect(model.population() == expectedPopulation &&
+                          otherSeed.population() == expectedPopulation,
+                      "exact population");
+  isPassing &= expect(model.populationSeed() == f_seed, "seed");
+  return isPassing;
+}
+
+// Jumps the way the runner and the J key do, stepping every generation when
+// the jump is refused, and compares with stepping alone.
+bool isJumpLikeSteps(Model &jumped, Model &stepped,
+                     std::size_t log2Generations, bool isJumpExpected) {
+  auto isJumped{jumped.jump(log2Generations)};
+  for (std::size_t generation = 0;
+       generation < (std::size_t{1} << log2Generations); generation++) {
+    if (!isJumped) {
+      jumped.update();
+    }
+    stepped.update();
+  }
+  return expect(isJumped == isJumpExpected,
+                isJumpExpected ? "jump made" : "jump refused") &&
+         expect(isEqual(jumped.aliveCells(), stepped.aliveCells()) &&
+                    jumped.population() == stepped.population() &&
+                    jumped.generation() == stepped.generation(),
+                "2^" + std::to_string(log2Generations) + " generations");
+}
+
+bool testJump() {
+  auto isPassing{true};
+  // A soup touching the edges, which cells outside the grid would reach in
+  // the unbounded plane HashLife evolves.
+  for (std::size_t log2Generations : {0, 3, 6}) {
+    Model jumped{f_width, f_height};
+    jumped.generatePopulation(f_density, f_seed);
+    Model stepped{f_width, f_height};
+    stepped.generatePopulation(f_density, f_seed);
+    isPassing &= isJumpLikeSteps(jumped, stepped, log2Generations, false);
+  }
+  // A soup far enough from the edges to be jumped.
+  auto patch{randomGrid(32, 32, f_seed)};
+  for (auto isUnbounded : {false, true}) {
+    Model jumped{f_width, f_width};
+    jumped.setUnbounded(isUnbounded);
+    jumped.insertPattern(patch);
+    Model stepped{f_width, f_width};
+    stepped.setUnbounded(isUnbounded);
+    stepped.insertPattern(patch);
+    isPassing &= isJumpLikeSteps(jumped, stepped, 6, true);
+  }
+  return isPassing;
+}
+
+// Runs a soup on the unbounded plane behind a small grid and on a bounded
+// grid large enough that it never reaches the edges, where the two must
+// agree.
+bool testSparsePlane() {
+  constexpr std::size_t windowSize{128};
+  constexpr std::size_t planeSize{1024};
+  constexpr std::size_t offset{(planeSize - windowSize) / 2};
+  auto patch{randomGrid(32, 32, f_seed)};
+  Model window{windowSize, windowSize};
+  window.setUnbounded(true);
+  window.insertPattern(patch);
+  Model plane{planeSize, planeSize};
+  plane.insertPattern(patch);
+  auto isPassing{true};
+  for (auto generation = 1; generation <= 300 && isPassing; generation++) {
+    window.update();
+    plane.update();
+    auto isMatching{window.population() == plane.population()};
+    for (std::size_t row = 0; row < windowSize && isMatching; row++) {
+      for (std::size_t col = 0; col < windowSize && isMatching; col++) {
+        isMatching = window.aliveCells().at(col, row) ==
+                     plane.aliveCells().at(offset + col, offset + row);
+      }
+    }
+    isPassing &= expect(isMatching,
+                        "generation " + std::to_string(generation));
+  }
+  HashLife cells;
+  window.storeCells(cells);
+  isPassing &= expect(cells.population() == plane.population(), "stored");
+  return isPassing;
+}
+
+bool testCycleDetection() {
+  auto isPassing{true};
+  Model glider{f_width, f_width};
+  glider.insertPattern(placedGrid(f_glider, f_width, f_width));
+  for (auto generation = 0; generation < 100; generation++) {
+    glider.update();
+  }
+  isPassing &= expect(!glider.cycle(), "no cycle for a glider");
+  Model blinker{f_width, f_height};
+  blinker.insertPattern(placedGrid(f_blinker, f_width, f_height));
+  for (auto generation = 0; generation < 10; generation++) {
+    blinker.update();
+  }
+  auto cycle{blinker.cycle()};
+  isPassing &= expect(cycle && cycle->period == 2, "period 2 for a blinker");
+  return isPassing;
+}
+
+// Steps a soup and edits cells through the simulation thread, and compares
+// every frame with a model changed alongside, as the frames only copy the
+// tiles that changed since they were last written.
+bool testSimulationFrames() {
+  Model model{f_width, f_height};
+  model.generatePopulation(f_density, f_seed);
+  Model expected{f_width, f_height};
+  expected.generatePopulation(f_density, f_seed);
+  Simulation simulation{model};
+  auto isPassing{true};
+  for (std::size_t round = 0; round < f_frameRounds; round++) {
+    Cell cell{round * 23 % f_width, round * 7 % f_height, Cell::Status::Alive};
+    auto change{[cell, round](Model &changed) {
+      for (std::size_t generation = 0; generation < round; generation++) {
+        changed.update();
+      }
+      changed.insertCell(cell);
+    }};
+    simulation.post(change);
+    change(expected);
+    while (simulation.frame().generation != expected.generation() ||
+           simulation.frame().population != expected.population()) {
+      if (!simulation.acquireFrame()) {
+        std::this_thread::yield();
+      }
+    }
+    const auto &frame{simulation.frame()};
+    isPassing &=
+        expect(isEqual(frame.cells, expected.aliveCells()) &&
+                   isEqual(frame.visitedCells, expected.visitedCells()),
+               "frame after round " + std::to_string(round));
+  }
+  return isPassing;
+}
+
+const std::vector<Test> f_tests{
+    {"kernel-scalar", [] { return testKernel(kernel::Isa::Scalar); }},
+    {"kernel-sse2", [] { return testKernel(kernel::Isa::Sse2); }},
+    {"kernel-avx2", [] { return testKernel(kernel::Isa::Avx2); }},
+    {"kernel-avx512", [] { return testKernel(kernel::Isa::Avx512); }},
+    {"rle-round-trip", [] { return testPatternRoundTrip("round-trip.rle"); }},
+    {"rle-parsing", testRleParsing},
+    {"macrocell-round-trip",
+     [] { return testPatternRoundTrip("round-trip.mc"); }},
+    {"checkpoint-round-trip", testCheckpointRoundTrip},
+    {"rewind", [] { return testRewind(f_historyMemoryLimit); }},
+    {"rewind-evicted", [] { return testRewind(f_smallHistoryMemoryLimit); }},
+    {"soup", testSoup},
+    {"hashlife-jump", testJump},
+    {"sparse-plane", testSparsePlane},
+    {"cycle-detection", testCycleDetection},
+    {"simulation-frames", testSimulationFrames}};
+} // namespace
+
+// Runs the test named by the argument, or all of them without one.
+int main(int argc, char **argv) {
+  auto failures{0};
+  auto isFound{false};
+  for (const auto &test : f_tests) {
+    if (argc > 1 && test.name != argv[1]) {
+      continue;
+    }
+    isFound = true;
+    auto isPassing{false};
+    try {
+      isPassing = test.run();
+    } catch (const std::exception &error) {
+      isPassing = expect(false, std::string{"exception: "} + error.what());
+    }
+    std::cout << (isPassing ? "passed " : "FAILED ") << test.name
+              << std::endl;
+    failures += isPassing ? 0 : 1;
+  }
+  if (!isFound) {
+    std::cerr << "Unknown test " << argv[1] << std::endl;
+    return 1;
+  }
+  return failures == 0 ? 0 : 1;
+}
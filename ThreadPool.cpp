@@ -0,0 +1,82 @@
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(std::size_t size)
+    : m_workers{}, m_mutex{}, m_jobReady{}, m_jobDone{}, m_task{nullptr},
+      m_nextTask{0}, m_taskCount{0}, m_busyWorkers{0}, m_job{0},
+      m_isStopping{false} {
+  resize(size);
+}
+
+ThreadPool::~ThreadPool() { stop(); }
+
+std::size_t ThreadPool::size() const { return m_workers.size() + 1; }
+
+void ThreadPool::resize(std::size_t size) {
+  stop();
+  m_isStopping = false;
+  for (std::size_t i = 1; i < std::max<std::size_t>(size, 1); i++) {
+    m_workers.emplace_back([this, job = m_job] { work(job); });
+  }
+}
+
+void ThreadPool::parallelFor(std::size_t count,
+                             const std::function<void(std::size_t)> &task) {
+  if (m_workers.empty() || count < 2) {
+    for (std::size_t i = 0; i < count; i++) {
+      task(i);
+    }
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    m_task = &task;
+    m_taskCount = count;
+    m_nextTask = 0;
+    m_busyWorkers = m_workers.size();
+    m_job++;
+  }
+  m_jobReady.notify_all();
+  runTasks();
+  std::unique_lock<std::mutex> lock{m_mutex};
+  m_jobDone.wait(lock, [this] { return m_busyWorkers == 0; });
+  m_task = nullptr;
+}
+
+void ThreadPool::work(std::size_t job) {
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock{m_mutex};
+      m_jobReady.wait(lock,
+                      [this, job] { return m_isStopping || m_job != job; });
+      if (m_isStopping) {
+        return;
+      }
+      job = m_job;
+    }
+    runTasks();
+    std::lock_guard<std::mutex> lock{m_mutex};
+    if (--m_busyWorkers == 0) {
+      m_jobDone.notify_one();
+    }
+  }
+}
+
+void ThreadPool::runTasks() {
+  for (auto task = m_nextTask++; task < m_taskCount; task = m_nextTask++) {
+    (*m_task)(task);
+  }
+}
+
+void ThreadPool::stop() {
+  {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    m_isStopping = true;
+  }
+  m_jobReady.notify_all();
+  for (auto &worker : m_workers) {
+    worker.join();
+  }
+  m_workers.clear();
+}
@@ -0,0 +1,45 @@
+#ifndef GAME_OF_LIFE_THREAD_POOL_HPP
+#define GAME_OF_LIFE_THREAD_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads that stay alive between jobs. The thread calling
+// parallelFor() takes part in the job, so a pool of size one spawns nothing.
+class ThreadPool {
+public:
+  explicit ThreadPool(std::size_t size);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  std::size_t size() const;
+
+  void resize(std::size_t size);
+  void parallelFor(std::size_t count,
+                   const std::function<void(std::size_t)> &task);
+
+private:
+  void work(std::size_t job);
+  void runTasks();
+  void stop();
+
+  std::vector<std::thread> m_workers;
+  std::mutex m_mutex;
+  std::condition_variable m_jobReady;
+  std::condition_variable m_jobDone;
+  const std::function<void(std::size_t)> *m_task;
+  std::atomic<std::size_t> m_nextTask;
+  std::size_t m_taskCount;
+  std::size_t m_busyWorkers;
+  std::size_t m_job;
+  bool m_isStopping;
+};
+
+#endif
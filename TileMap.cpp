@@ -0,0 +1,67 @@
+#include "TileMap.hpp"
+
+#include <algorithm>
+
+namespace {
+inline auto toTileCount(std::size_t cells, std::size_t tileSize) {
+  return (cells + tileSize - 1) / tileSize;
+}
+} // namespace
+
+TileMap::TileMap(std::size_t width, std::size_t height)
+    : m_columns{toTileCount(width, tileWidth)},
+      m_rows{toTileCount(height, tileHeight)}, m_activeCount{0},
+      m_changed(m_columns * m_rows, 1), m_active(m_columns * m_rows, 0),
+      m_dirty(m_columns * m_rows, 1) {}
+
+std::size_t TileMap::columns() const { return m_columns; }
+
+std::size_t TileMap::rows() const { return m_rows; }
+
+std::size_t TileMap::size() const { return m_columns * m_rows; }
+
+std::size_t TileMap::activeCount() const { return m_activeCount; }
+
+bool TileMap::isActive(std::size_t col, std::size_t row) const {
+  return m_active[row * m_columns + col] != 0;
+}
+
+bool TileMap::isDirty(std::size_t col, std::size_t row) const {
+  return m_dirty[row * m_columns + col] != 0;
+}
+
+void TileMap::activate() {
+  m_activeCount = 0;
+  for (std::size_t row = 0; row < m_rows; row++) {
+    for (std::size_t col = 0; col < m_columns; col++) {
+      std::uint8_t active{0};
+      for (auto r = std::max<std::size_t>(row, 1) - 1;
+           r <= std::min(row + 1, m_rows - 1) && !active; r++) {
+        for (auto c = std::max<std::size_t>(col, 1) - 1;
+             c <= std::min(col + 1, m_columns - 1) && !active; c++) {
+          active = m_changed[r * m_columns + c];
+        }
+      }
+      m_active[row * m_columns + col] = active;
+      m_activeCount += active;
+    }
+  }
+}
+
+void TileMap::setChanged(std::size_t col, std::size_t row, bool changed) {
+  m_changed[row * m_columns + col] = changed ? 1 : 0;
+  if (changed) {
+    m_dirty[row * m_columns + col] = 1;
+  }
+}
+
+void TileMap::markCellChanged(std::size_t col, std::size_t row) {
+  setChanged(col / tileWidth, row / tileHeight, true);
+}
+
+void TileMap::markAllChanged() {
+  std::fill(m_changed.begin(), m_changed.end(), 1);
+  std::fill(m_dirty.begin(), m_dirty.end(), 1);
+}
+
+void TileMap::clearDirty() { std::fill(m_dirty.begin(), m_dirty.end(), 0); }
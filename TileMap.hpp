@@ -0,0 +1,44 @@
+#ifndef GAME_OF_LIFE_TILE_MAP_HPP
+#define GAME_OF_LIFE_TILE_MAP_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Grid.hpp"
+
+// Splits a grid into tiles one word wide and records which of them changed in
+// the last generation. A tile only needs to be evolved when it or one of its
+// eight neighbours changed; every other tile is known to stay as it is.
+// Tiles are also flagged dirty whenever they change, until the flags are
+// cleared, so that copies of the grid can be brought up to date tile by tile.
+class TileMap {
+public:
+  static constexpr std::size_t tileWidth{Grid::bitsPerWord};
+  static constexpr std::size_t tileHeight{32};
+
+  TileMap(std::size_t width, std::size_t height);
+
+  std::size_t columns() const;
+  std::size_t rows() const;
+  std::size_t size() const;
+  std::size_t activeCount() const;
+  bool isActive(std::size_t col, std::size_t row) const;
+  bool isDirty(std::size_t col, std::size_t row) const;
+
+  void activate();
+  void setChanged(std::size_t col, std::size_t row, bool changed);
+  void markCellChanged(std::size_t col, std::size_t row);
+  void markAllChanged();
+  void clearDirty();
+
+private:
+  std::size_t m_columns;
+  std::size_t m_rows;
+  std::size_t m_activeCount;
+  std::vector<std::uint8_t> m_changed;
+  std::vector<std::uint8_t> m_active;
+  std::vector<std::uint8_t> m_dirty;
+};
+
+#endif
@@ -2,12 +2,16 @@
 
 #include <SFML/Graphics/RectangleShape.hpp>
 #include <SFML/Window/Mouse.hpp>
+#include <algorithm>
+#include <bitset>
 #include <cmath>
 #include <execution>
 #include <future>
+#include <iomanip>
 #include <sstream>
 #include <thread>
 
+#include "Profiler.hpp"
 #include "RleHelper.hpp"
 
 namespace {
@@ -50,6 +54,8 @@ constexpr auto f_defaultZoomLevel{5};
 constexpr auto f_minZoomLevel{1};
 constexpr auto f_maxZoomLevel{10};
 constexpr auto f_zoomSensibility{1};
+// Smallest cell size, in pixels, at which grid lines are drawn over the cells.
+constexpr auto f_minGridCellSize{4.f};
 constexpr auto f_textBoxTextVerticalPosition{14.f};
 constexpr auto f_defaultButtonWidth{f_defaultScreenWidth / 13.f};
 constexpr auto f_addRemoveCellTextWidth{290.f};
@@ -63,12 +69,44 @@ constexpr auto f_pageUpDownTextWidth{370.f};
 constexpr auto f_scrollUpDownTextWidth{330.f};
 constexpr auto f_ruleEditBoxWidth{220.f};
 constexpr auto f_editRuleMenuInfoTextWidth{120.f};
+constexpr auto f_profilerOverlayWidth{360.f};
 
-inline std::string toString(const std::set<std::size_t> &values) {
+inline std::string toString(std::uint16_t ruleMask) {
   std::stringstream s;
-  for (const auto &val : values) {
-    s << val;
+  for (std::size_t value = 0; (ruleMask >> value) != 0; value++) {
+    if ((ruleMask >> value) & 1) {
+      s << value;
+    }
+  }
+  return s.str();
+}
+
+inline std::string toString(const PatternIndex::Entry &entry) {
+  std::stringstream s;
+  s << entry.name << "    ";
+  if (!entry.error.empty()) {
+    s << "(" << entry.error << ")";
+    return s.str();
+  }
+  s << entry.width << "x" << entry.height << ", " << entry.population
+    << " cells";
+  if (entry.rule) {
+    s << ", " << rle::toString(entry.rule.value());
+  }
+  return s.str();
+}
+
+inline std::string toRateString(double generationRate) {
+  std::stringstream s;
+  s << std::fixed << std::setprecision(1);
+  if (generationRate >= 1e6) {
+    s << generationRate / 1e6 << "M";
+  } else if (generationRate >= 1e3) {
+    s << generationRate / 1e3 << "k";
+  } else {
+    s << std::setprecision(0) << generationRate;
   }
+  s << "/s";
   return s.str();
 }
 
@@ -84,14 +122,29 @@ inline sf::Color toCellColor(Cell::Status status) {
 }
 } // namespace
 
-View::View(sf::RenderWindow &window, Model &model)
-    : m_model{model}, m_screen{Screen::Main}, m_window{window},
+View::View(sf::RenderWindow &window, Simulation &simulation,
+           const PatternLoader &patternLoader)
+    : m_simulation{simulation}, m_patternLoader{patternLoader},
+      m_patternIndex{rle::patternsFolder()},
+      m_screen{Screen::Main}, m_window{window},
       m_topLeftCellPos{f_frameVerticalThickness, f_frameHorizontalThickness},
-      m_cellsVertexArray{sf::Quads, 4 * model.width() * model.height()},
-      m_font{}, m_highlightedButton{Button::None},
+      m_cellsVertexArray{sf::Quads}, m_cellsTexture{}, m_cellsSprite{},
+      m_cellsPixels{}, m_isCellsTextureCreated{false},
+      m_drawnCells{simulation.width(), simulation.height()},
+      m_drawnVisitedCells{simulation.width(), simulation.height()},
+      m_gridVertexArray{sf::Lines}, m_isLayoutChanged{true}, m_font{},
+      m_textBoxes{}, m_textBoxCount{0},
+      m_highlightedButton{Button::None},
       m_highlightedEdit{Edit::None}, m_highlightedLoadFileMenuItem{},
       m_zoomLevel{f_defaultZoomLevel}, m_scrollPos{}, m_fileNameToSave{} {
   m_font.loadFromFile(f_fontPath);
+  auto maxTextureSize{sf::Texture::getMaximumSize()};
+  m_isCellsTextureCreated =
+      simulation.width() <= maxTextureSize &&
+      simulation.height() <= maxTextureSize &&
+      m_cellsTexture.create(static_cast<unsigned>(simulation.width()),
+                            static_cast<unsigned>(simulation.height()));
+  m_cellsSprite.setTexture(m_cellsTexture);
 }
 
 void View::setFileNameToSave(const std::string &name) {
@@ -116,8 +169,11 @@ std::optional<Cell> View::highlightedCell() const {
 const std::string &View::fileNameToSave() const { return m_fileNameToSave; }
 
 void View::update() {
+  PROFILE_SCOPE(Profiler::Stage::Frame);
+  m_simulation.acquireFrame();
   m_window.clear();
   m_highlightedButton = Button::None;
+  m_textBoxCount = 0;
   drawBackground();
   switch (m_screen) {
   case Screen::EditRule:
@@ -173,19 +229,52 @@ void View::drawMainScreen() {
   m_fileNameToSave.clear();
   m_scrollPos = 0;
   drawCells_();
-  drawGrid();
+  auto cellSize{calculateCellSize()};
+  if (std::min(cellSize.x, cellSize.y) >= f_minGridCellSize) {
+    drawGrid();
+  }
+  m_isLayoutChanged = false;
   drawFrame();
   drawTopMenu();
+  const auto &error{m_simulation.frame().error};
+  if (!error.empty()) {
+    drawTextBox(error,
+                {f_frameVerticalThickness + f_textBoxOutlineThickness,
+                 f_frameHorizontalThickness},
+                f_defaultScreenWidth - 2 * f_frameVerticalThickness,
+                TextBoxStyle::Text);
+  }
+  if (Profiler::instance().isEnabled()) {
+    drawProfilerOverlay();
+  }
 }
 
 void View::drawLoadFileScreen() {
   m_highlightedLoadFileMenuItem.reset();
   sf::Vector2f position{f_frameVerticalThickness + f_textBoxOutlineThickness,
                         f_textBoxOutlineThickness};
-  if (drawTextBox("Back [Esc]", position, f_defaultButtonWidth,
-                  TextBoxStyle::Button)) {
+  auto loaderStatus{m_patternLoader.status()};
+  auto isLoading{loaderStatus == PatternLoader::Status::Loading};
+  if (drawTextBox(isLoading ? "Cancel [Esc]" : "Back [Esc]", position,
+                  f_defaultButtonWidth, TextBoxStyle::Button)) {
     m_highlightedButton = Button::Back;
   }
+  if (isLoading || loaderStatus == PatternLoader::Status::Failed) {
+    std::stringstream message;
+    if (isLoading) {
+      message << "Loading " << m_patternLoader.name() << "... "
+              << static_cast<int>(m_patternLoader.progress() * 100.f) << "%";
+    } else {
+      message << "Cannot load " << m_patternLoader.name() << ": "
+              << m_patternLoader.error();
+    }
+    position.x = f_frameVerticalThickness + f_textBoxOutlineThickness;
+    position.y = f_defaultScreenHeight * .5f;
+    drawTextBox(message.str(), position,
+                f_defaultScreenWidth - 2 * f_frameVerticalThickness,
+                TextBoxStyle::Text);
+    return;
+  }
   position.x += f_defaultButtonWidth;
   drawTextBox("Scroll Up/Down [Mouse Wheel]", position, f_scrollUpDownTextWidth,
               TextBoxStyle::Text);
@@ -195,28 +284,29 @@ void View::drawLoadFileScreen() {
   auto maxNumberOfItems{
       static_cast<int>(f_defaultScreenHeight /
                        (f_textBoxHeight + f_textBoxOutlineThickness * 2.))};
-  auto items{rle::listPatternNames()};
-  if (items.empty()) {
+  auto items{m_patternIndex.entries()};
+  if (!items || items->empty()) {
     auto screenMiddleHeight{f_defaultScreenHeight * .5f};
     position.x = f_frameVerticalThickness + f_textBoxOutlineThickness;
     position.y = screenMiddleHeight;
-    drawTextBox("No files found in patterns directory.", position,
-                f_defaultScreenWidth - 2 * f_frameVerticalThickness,
+    drawTextBox(items ? "No files found in patterns directory."
+                      : "Reading patterns directory...",
+                position, f_defaultScreenWidth - 2 * f_frameVerticalThickness,
                 TextBoxStyle::Text);
     return;
   }
-  auto itemsSize{static_cast<int>(items.size())};
-  auto maxScrollPos{std::min(itemsSize, maxNumberOfItems)};
-  m_scrollPos = std::min(m_scrollPos, maxScrollPos - 1);
-  auto topItem{std::next(items.cbegin(), m_scrollPos)};
-  auto maxItem{std::next(items.cbegin(), maxScrollPos)};
-  for (auto it = topItem; it != maxItem; it++) {
+  auto itemsSize{static_cast<int>(items->size())};
+  auto maxScrollPos{std::max(0, itemsSize - maxNumberOfItems)};
+  m_scrollPos = std::min(m_scrollPos, maxScrollPos);
+  auto lastItem{std::min(itemsSize, m_scrollPos + maxNumberOfItems)};
+  for (auto index = m_scrollPos; index < lastItem; index++) {
+    const auto &item{(*items)[static_cast<std::size_t>(index)]};
     auto width{f_defaultScreenWidth - 2 * f_frameVerticalThickness};
     auto x{f_frameVerticalThickness};
     auto y{f_frameHorizontalThickness + f_textBoxOutlineThickness +
-           static_cast<float>(std::distance(topItem, it)) * f_textBoxHeight};
-    if (drawTextBox(*it, {x, y}, width, TextBoxStyle::Button)) {
-      m_highlightedLoadFileMenuItem = *it;
+           static_cast<float>(index - m_scrollPos) * f_textBoxHeight};
+    if (drawTextBox(toString(item), {x, y}, width, TextBoxStyle::Button)) {
+      m_highlightedLoadFileMenuItem = item.name;
     }
   }
 }
@@ -254,8 +344,9 @@ void View::drawEditRuleScreen() {
   position.x = f_frameVerticalThickness + f_textBoxOutlineThickness;
   position.y = f_defaultScreenHeight * .5f;
   auto buttonWidth{f_defaultScreenWidth * .5f - f_textBoxOutlineThickness};
+  auto ruleMasks{m_simulation.frame().rule};
   std::string rule{"B"};
-  rule.append(toString(m_model.birthRule()));
+  rule.append(toString(ruleMasks.birthMask));
   auto style{m_highlightedEdit == Edit::BirthRule ? TextBoxStyle::Display
                                                   : TextBoxStyle::Button};
   auto isBirthRuleEditHighlighted{
@@ -267,7 +358,7 @@ void View::drawEditRuleScreen() {
   }
   position.x += buttonWidth + 2 * f_textBoxOutlineThickness;
   rule = "S";
-  rule.append(toString(m_model.survivalRule()));
+  rule.append(toString(ruleMasks.survivalMask));
   style = m_highlightedEdit == Edit::SurvivalRule ? TextBoxStyle::Display
                                                   : TextBoxStyle::Button;
   auto isSurvivalRuleEditHighlighted{
@@ -300,54 +391,195 @@ void View::drawBackground() {
   m_window.draw(background);
 }
 
+// Lines are kept between frames and only laid out again, for the visible
+// cells alone, after the view moved.
 void View::drawGrid() {
-  auto cellSize{calculateCellSize()};
-  sf::VertexArray lines{sf::Lines, 2 * (m_model.width() + m_model.height())};
-  std::size_t index{0};
-  for (std::size_t x = 0; x < m_model.width(); x++) {
-    auto pos{static_cast<float>(x) * cellSize.x + m_topLeftCellPos.x};
-    lines[index].position = sf::Vector2f(pos, 0);
-    lines[index++].color = f_gridColor;
-    lines[index].position = sf::Vector2f(pos, f_defaultScreenHeight);
-    lines[index++].color = f_gridColor;
+  PROFILE_SCOPE(Profiler::Stage::DrawGrid);
+  if (m_isLayoutChanged) {
+    auto range{calculateVisibleCells()};
+    auto cellSize{calculateCellSize()};
+    m_gridVertexArray.clear();
+    for (auto x = range.firstCol; x < range.lastCol; x++) {
+      auto pos{static_cast<float>(x) * cellSize.x + m_topLeftCellPos.x};
+      m_gridVertexArray.append({{pos, 0}, f_gridColor});
+      m_gridVertexArray.append({{pos, f_defaultScreenHeight}, f_gridColor});
+    }
+    for (auto y = range.firstRow; y < range.lastRow; y++) {
+      auto pos{static_cast<float>(y) * cellSize.y + m_topLeftCellPos.y};
+      m_gridVertexArray.append({{0, pos}, f_gridColor});
+      m_gridVertexArray.append({{f_defaultScreenWidth, pos}, f_gridColor});
+    }
   }
-  for (std::size_t y = 0; y < m_model.height(); y++) {
-    auto pos{static_cast<float>(y) * cellSize.y + m_topLeftCellPos.y};
-    lines[index].position = sf::Vector2f(0, pos);
-    lines[index++].color = f_gridColor;
-    lines[index].position = sf::Vector2f(f_defaultScreenWidth, pos);
-    lines[index++].color = f_gridColor;
+  m_window.draw(m_gridVertexArray);
+}
+
+// Calls `visit(col, row)` for every cell in range whose status differs from
+// the one last drawn, skipping unchanged words, and records the words that
+// changed as drawn.
+template <typename Visitor>
+void View::forEachChangedCell(const CellRange &range, Visitor visit) {
+  const auto &frame{m_simulation.frame()};
+  auto firstWord{range.firstCol / Grid::bitsPerWord};
+  auto lastWord{(range.lastCol - 1) / Grid::bitsPerWord};
+  for (auto row = range.firstRow; row < range.lastRow; row++) {
+    const auto *cells{frame.cells.row(row)};
+    const auto *visitedCells{frame.visitedCells.row(row)};
+    auto *drawnCells{m_drawnCells.row(row)};
+    auto *drawnVisitedCells{m_drawnVisitedCells.row(row)};
+    for (auto index = firstWord; index <= lastWord; index++) {
+      auto changes{(cells[index] ^ drawnCells[index]) |
+                   (visitedCells[index] ^ drawnVisitedCells[index])};
+      if (changes == 0) {
+        continue;
+      }
+      drawnCells[index] = cells[index];
+      drawnVisitedCells[index] = visitedCells[index];
+      for (; changes != 0; changes &= changes - 1) {
+        auto lowestBit{changes & (~changes + 1)};
+        auto col{index * Grid::bitsPerWord +
+                 std::bitset<Grid::bitsPerWord>{lowestBit - 1}.count()};
+        if (col >= range.firstCol && col < range.lastCol) {
+          visit(col, row);
+        }
+      }
+    }
   }
-  m_window.draw(lines);
 }
 
+// Only the cells inside the window are drawn, so the cost follows the zoom
+// level rather than the size of the grid, and unless the view moved only the
+// cells that changed since the last frame are rewritten.
 void View::drawCells_() {
-  auto size{4 * m_model.width() * m_model.height()};
-  if (m_cellsVertexArray.getVertexCount() != size) {
-    m_cellsVertexArray.resize(size);
+  PROFILE_SCOPE(Profiler::Stage::DrawCells);
+  auto range{calculateVisibleCells()};
+  if (range.firstCol == range.lastCol || range.firstRow == range.lastRow) {
+    return;
+  }
+  if (m_isCellsTextureCreated) {
+    drawCellTexture(range);
+  } else {
+    drawCellQuads(range);
+  }
+  if (m_isLayoutChanged) {
+    copyDrawnCells(range);
+  }
+}
+
+// Records the words in range as drawn after all of them were redrawn.
+void View::copyDrawnCells(const CellRange &range) {
+  const auto &frame{m_simulation.frame()};
+  auto firstWord{range.firstCol / Grid::bitsPerWord};
+  auto lastWord{(range.lastCol - 1) / Grid::bitsPerWord};
+  for (auto row = range.firstRow; row < range.lastRow; row++) {
+    const auto *cells{frame.cells.row(row)};
+    const auto *visitedCells{frame.visitedCells.row(row)};
+    std::copy(cells + firstWord, cells + lastWord + 1,
+              m_drawnCells.row(row) + firstWord);
+    std::copy(visitedCells + firstWord, visitedCells + lastWord + 1,
+              m_drawnVisitedCells.row(row) + firstWord);
   }
+}
+
+// The texture keeps the cells drawn last, so only the rectangle around the
+// ones that changed is uploaded again.
+void View::drawCellTexture(const CellRange &range) {
+  auto changed{range};
+  if (!m_isLayoutChanged) {
+    changed = {range.lastCol, range.firstCol, range.lastRow, range.firstRow};
+    forEachChangedCell(range, [&changed](std::size_t col, std::size_t row) {
+      changed.firstCol = std::min(changed.firstCol, col);
+      changed.lastCol = std::max(changed.lastCol, col + 1);
+      changed.firstRow = std::min(changed.firstRow, row);
+      changed.lastRow = std::max(changed.lastRow, row + 1);
+    });
+  }
+  if (changed.firstCol < changed.lastCol) {
+    updateCellTexture(changed);
+  }
+  m_cellsSprite.setTextureRect(
+      {static_cast<int>(range.firstCol), static_cast<int>(range.firstRow),
+       static_cast<int>(range.lastCol - range.firstCol),
+       static_cast<int>(range.lastRow - range.firstRow)});
+  m_cellsSprite.setPosition(
+      calculateCellPosition(range.firstCol, range.firstRow));
+  m_cellsSprite.setScale(calculateCellSize());
+  m_window.draw(m_cellsSprite);
+}
+
+// Vertex positions are only laid out again after the view moved, otherwise
+// the quads of the cells that changed are recoloured in place.
+void View::drawCellQuads(const CellRange &range) {
+  auto cols{range.lastCol - range.firstCol};
+  const auto &frame{m_simulation.frame()};
+  if (!m_isLayoutChanged) {
+    forEachChangedCell(range, [this, &range, &frame, cols](std::size_t col,
+                                                           std::size_t row) {
+      auto cellColor{toCellColor(frame.cellAt(col, row)->status)};
+      auto id{4 * ((row - range.firstRow) * cols + col - range.firstCol)};
+      for (auto vertex = id; vertex < id + 4; vertex++) {
+        m_cellsVertexArray[vertex].color = cellColor;
+      }
+    });
+    m_window.draw(m_cellsVertexArray);
+    return;
+  }
+  auto rows{range.lastRow - range.firstRow};
+  m_cellsVertexArray.resize(4 * cols * rows);
   auto cellSize{calculateCellSize()};
-  auto &cells{m_model.cells()};
-  std::for_each(cells.cbegin(), cells.cend(), [this, cellSize](auto &cell) {
-    auto cellColor = toCellColor(cell.status);
-    auto cellPosition = calculateCellPosition(cell.col, cell.row);
-    auto id{(cell.col + cell.row * m_model.width()) * 4};
-    m_cellsVertexArray[id].position = cellPosition;
-    m_cellsVertexArray[id++].color = cellColor;
-    m_cellsVertexArray[id].position =
-        cellPosition + sf::Vector2f{cellSize.x, 0};
-    m_cellsVertexArray[id++].color = cellColor;
-    m_cellsVertexArray[id].position =
-        cellPosition + sf::Vector2f{cellSize.x, cellSize.y};
-    m_cellsVertexArray[id++].color = cellColor;
-    m_cellsVertexArray[id].position =
-        cellPosition + sf::Vector2f{0, cellSize.y};
-    m_cellsVertexArray[id].color = cellColor;
-  });
+  std::size_t id{0};
+  for (auto row = range.firstRow; row < range.lastRow; row++) {
+    for (auto col = range.firstCol; col < range.lastCol; col++) {
+      auto cellColor = toCellColor(frame.cellAt(col, row)->status);
+      auto cellPosition = calculateCellPosition(col, row);
+      m_cellsVertexArray[id].position = cellPosition;
+      m_cellsVertexArray[id++].color = cellColor;
+      m_cellsVertexArray[id].position =
+          cellPosition + sf::Vector2f{cellSize.x, 0};
+      m_cellsVertexArray[id++].color = cellColor;
+      m_cellsVertexArray[id].position =
+          cellPosition + sf::Vector2f{cellSize.x, cellSize.y};
+      m_cellsVertexArray[id++].color = cellColor;
+      m_cellsVertexArray[id].position =
+          cellPosition + sf::Vector2f{0, cellSize.y};
+      m_cellsVertexArray[id++].color = cellColor;
+    }
+  }
   m_window.draw(m_cellsVertexArray);
 }
 
+// Writes a pixel per cell in range straight from the grid words and uploads
+// them in a single texture update, at 4 bytes per cell where a quad takes 80.
+void View::updateCellTexture(const CellRange &range) {
+  auto cols{range.lastCol - range.firstCol};
+  auto rows{range.lastRow - range.firstRow};
+  m_cellsPixels.resize(4 * cols * rows);
+  const auto &frame{m_simulation.frame()};
+  auto *pixel{m_cellsPixels.data()};
+  for (auto row = range.firstRow; row < range.lastRow; row++) {
+    const auto *aliveWords{frame.cells.row(row)};
+    const auto *visitedWords{frame.visitedCells.row(row)};
+    for (auto col = range.firstCol; col < range.lastCol; col++) {
+      auto word{col / Grid::bitsPerWord};
+      auto bit{col % Grid::bitsPerWord};
+      auto status{((aliveWords[word] >> bit) & 1)     ? Cell::Status::Alive
+                  : ((visitedWords[word] >> bit) & 1) ? Cell::Status::Dead
+                                                      : Cell::Status::Empty};
+      auto color{toCellColor(status)};
+      *pixel++ = color.r;
+      *pixel++ = color.g;
+      *pixel++ = color.b;
+      *pixel++ = color.a;
+    }
+  }
+  m_cellsTexture.update(m_cellsPixels.data(), static_cast<unsigned>(cols),
+                        static_cast<unsigned>(rows),
+                        static_cast<unsigned>(range.firstCol),
+                        static_cast<unsigned>(range.firstRow));
+}
+
 void View::drawTopMenu() {
+  PROFILE_SCOPE(Profiler::Stage::DrawMenu);
+  const auto &frame{m_simulation.frame()};
   sf::RectangleShape rect{{f_defaultScreenWidth, f_frameHorizontalThickness}};
   rect.setFillColor(f_frameColor);
   m_window.draw(rect);
@@ -362,16 +594,16 @@ void View::drawTopMenu() {
     m_highlightedButton = Button::LoadFile;
   }
   position.x += f_defaultButtonWidth;
-  auto style{m_model.initialPattern().empty() ? TextBoxStyle::HiddenButton
-                                              : TextBoxStyle::Button};
+  auto style{frame.hasInitialPattern ? TextBoxStyle::Button
+                                     : TextBoxStyle::HiddenButton};
   if (drawTextBox("Save File [S]", position, f_defaultButtonWidth, style)) {
     m_highlightedButton = Button::SaveFile;
   }
   position.x += f_defaultButtonWidth;
-  style = m_model.status() == Model::Status::Stopped
+  style = frame.status == Model::Status::Stopped
               ? TextBoxStyle::HiddenButton
               : TextBoxStyle::Button;
-  switch (m_model.status()) {
+  switch (frame.status) {
   case Model::Status::Stopped:
   case Model::Status::ReadyToRun:
     if (drawTextBox("Start [_]", position, f_defaultButtonWidth, style)) {
@@ -393,40 +625,40 @@ void View::drawTopMenu() {
   }
   position.x += f_defaultButtonWidth;
   style =
-      (m_model.status() != Model::Status::Running)
+      (frame.status != Model::Status::Running)
           ? TextBoxStyle::HiddenButton
-          : (m_model.speed() == m_model.minSpeed() ? TextBoxStyle::HiddenButton
-                                                   : TextBoxStyle::Button);
+          : (frame.speed == frame.minSpeed ? TextBoxStyle::HiddenButton
+                                         : TextBoxStyle::Button);
   if (drawTextBox(">", position, f_plusMinusButtonWidth, style)) {
     m_highlightedButton = Button::SlowDown;
   }
   style =
-      (m_model.status() != Model::Status::Running)
+      (frame.status != Model::Status::Running)
           ? TextBoxStyle::HiddenButton
-          : (m_model.speed() == m_model.maxSpeed() ? TextBoxStyle::HiddenButton
-                                                   : TextBoxStyle::Button);
+          : (frame.speed == frame.maxSpeed ? TextBoxStyle::HiddenButton
+                                         : TextBoxStyle::Button);
   position.x += f_plusMinusButtonWidth;
   if (drawTextBox(">>", position, f_plusMinusButtonWidth, style)) {
     m_highlightedButton = Button::SpeedUp;
   }
   position.x += f_plusMinusButtonWidth;
-  style = (m_model.status() == Model::Status::ReadyToRun ||
-           m_model.status() == Model::Status::Stopped)
+  style = (frame.status == Model::Status::ReadyToRun ||
+           frame.status == Model::Status::Stopped)
               ? TextBoxStyle::HiddenButton
               : TextBoxStyle::Button;
   if (drawTextBox("Reset [R]", position, f_defaultButtonWidth, style)) {
     m_highlightedButton = Button::Reset;
   }
   position.x += f_defaultButtonWidth;
-  style = (m_model.status() == Model::Status::Stopped)
+  style = (frame.status == Model::Status::Stopped)
               ? TextBoxStyle::HiddenButton
               : TextBoxStyle::Button;
   if (drawTextBox("Clear [C]", position, f_defaultButtonWidth, style)) {
     m_highlightedButton = Button::Clear;
   }
   position.x += f_defaultButtonWidth;
-  style = (m_model.status() == Model::Status::ReadyToRun ||
-           m_model.status() == Model::Status::Stopped)
+  style = (frame.status == Model::Status::ReadyToRun ||
+           frame.status == Model::Status::Stopped)
               ? TextBoxStyle::Button
               : TextBoxStyle::HiddenButton;
   if (drawTextBox("Generate [G]", position, f_defaultButtonWidth, style)) {
@@ -434,73 +666,167 @@ void View::drawTopMenu() {
   }
   position.x += f_defaultButtonWidth;
   std::string rule("RLE B");
-  rule.append(toString(m_model.birthRule()));
+  rule.append(toString(frame.rule.birthMask));
   rule.append("/S");
-  rule.append(toString(m_model.survivalRule()));
-  style = (m_model.status() != Model::Status::Stopped &&
-           m_model.status() != Model::Status::ReadyToRun)
+  rule.append(toString(frame.rule.survivalMask));
+  style = (frame.status != Model::Status::Stopped &&
+           frame.status != Model::Status::ReadyToRun)
               ? TextBoxStyle::HiddenButton
               : TextBoxStyle::Button;
   if (drawTextBox(rule, position, f_defaultButtonWidth, style)) {
     m_highlightedButton = Button::EditRule;
   }
   position.x += f_defaultButtonWidth;
-  drawTextBox("Generation", position, f_defaultButtonWidth, TextBoxStyle::Text);
+  // The label gives way to the achieved rate while the model runs.
+  std::string generationLabel{"Generation"};
+  if (frame.status == Model::Status::Running) {
+    generationLabel = toRateString(frame.generationRate);
+    if (frame.isTurbo) {
+      generationLabel.insert(0, "Turbo ");
+    }
+  }
+  drawTextBox(generationLabel, position, f_defaultButtonWidth,
+              TextBoxStyle::Text);
   position.x += f_defaultButtonWidth;
-  drawTextBox(std::to_string(m_model.generation()), position,
-              f_defaultButtonWidth, TextBoxStyle::Display);
+  auto generation{std::to_string(frame.generation)};
+  if (auto cycle{frame.cycle}) {
+    generation += " (p" + std::to_string(cycle->period) + ")";
+  }
+  drawTextBox(generation, position, f_defaultButtonWidth,
+              TextBoxStyle::Display);
   position.x += f_defaultButtonWidth;
   drawTextBox("Population", position, f_defaultButtonWidth, TextBoxStyle::Text);
   position.x += f_defaultButtonWidth;
-  drawTextBox(std::to_string(m_model.population()), position,
+  drawTextBox(std::to_string(frame.population), position,
               f_defaultButtonWidth, TextBoxStyle::Display);
   position.x += f_defaultButtonWidth;
 }
 
+// Median and 99th percentile of the latest durations of every stage, stacked
+// in the bottom left corner.
+void View::drawProfilerOverlay() {
+  sf::Vector2f position{f_frameVerticalThickness + f_textBoxOutlineThickness,
+                        f_defaultScreenHeight -
+                            f_textBoxHeight *
+                                static_cast<float>(Profiler::stageCount)};
+  for (std::size_t index = 0; index < Profiler::stageCount; index++) {
+    auto stage{static_cast<Profiler::Stage>(index)};
+    auto statistics{Profiler::instance().statistics(stage)};
+    std::stringstream s;
+    s << Profiler::name(stage) << "  p50 " << std::fixed
+      << std::setprecision(2) << statistics.p50 << "ms  p99 "
+      << statistics.p99 << "ms";
+    drawTextBox(s.str(), position, f_profilerOverlayWidth, TextBoxStyle::Text);
+    position.y += f_textBoxHeight;
+  }
+}
+
+// Text boxes are matched with the ones of the previous frame by the order in
+// which they are drawn, and only the ones that changed are laid out again.
 bool View::drawTextBox(const std::string &content, const sf::Vector2f &position,
                        float width, TextBoxStyle style) {
-  auto highlighted{false};
-  sf::RectangleShape rect{{width - 2 * f_textBoxOutlineThickness,
-                           f_textBoxHeight - 2 * f_textBoxOutlineThickness}};
+  if (m_textBoxCount == m_textBoxes.size()) {
+    m_textBoxes.push_back(
+        {content, position, width, style, TextBoxState::Normal, {}, {}});
+    layOutTextBox(m_textBoxes.back());
+  }
+  auto &textBox{m_textBoxes[m_textBoxCount++]};
+  if (textBox.content != content || textBox.position != position ||
+      textBox.width != width || textBox.style != style) {
+    textBox.content = content;
+    textBox.position = position;
+    textBox.width = width;
+    textBox.style = style;
+    layOutTextBox(textBox);
+  }
+  auto state{TextBoxState::Normal};
+  if (style == TextBoxStyle::Button &&
+      textBox.rect.getGlobalBounds().contains(
+          m_window.mapPixelToCoords(sf::Mouse::getPosition(m_window)))) {
+    state = sf::Mouse::isButtonPressed(sf::Mouse::Left)
+                ? TextBoxState::Clicked
+                : TextBoxState::Highlighted;
+  }
+  if (state != textBox.state) {
+    textBox.state = state;
+    applyTextBoxColors(textBox);
+  }
+  m_window.draw(textBox.rect);
+  m_window.draw(textBox.text);
+  return state != TextBoxState::Normal;
+}
+
+// Content too wide for the box loses as many characters from both ends as
+// needed, found by binary search over the number removed.
+void View::layOutTextBox(TextBox &textBox) {
+  const auto &position{textBox.position};
+  auto &rect{textBox.rect};
+  auto &text{textBox.text};
+  rect.setSize({textBox.width - 2 * f_textBoxOutlineThickness,
+                f_textBoxHeight - 2 * f_textBoxOutlineThickness});
   rect.setPosition(position.x + f_textBoxOutlineThickness,
                    position.y + f_textBoxOutlineThickness);
   rect.setOutlineThickness(f_textBoxOutlineThickness);
-  sf::Text text{content, m_font};
+  text.setFont(m_font);
   text.setCharacterSize(f_fontSize);
-  auto c{content};
-  while (text.getLocalBounds().width > rect.getSize().x) {
-    c.erase(0, 1);
-    c.erase(c.size() - 1, 1);
-    text.setString("..." + c + "...");
-  }
-  text.setPosition(position.x + (width - text.getLocalBounds().width) * .5f,
-                   position.y + f_textBoxTextVerticalPosition);
-  switch (style) {
-  case TextBoxStyle::Button:
-    if (rect.getGlobalBounds().contains(
-            m_window.mapPixelToCoords(sf::Mouse::getPosition(m_window)))) {
-      highlighted = true;
-      if (sf::Mouse::isButtonPressed(sf::Mouse::Left)) {
-        rect.setFillColor(f_clickedButtonFillColor);
-        rect.setOutlineColor(f_clickedButtonOutlineColor);
-        text.setFillColor(f_clickedButtonTextColor);
+  const auto &content{textBox.content};
+  text.setString(content);
+  auto maxWidth{rect.getSize().x};
+  if (text.getLocalBounds().width > maxWidth) {
+    auto truncated{[&content](std::size_t count) {
+      return "..." + content.substr(count, content.size() - 2 * count) + "...";
+    }};
+    std::size_t fewest{1};
+    auto most{std::max(fewest, content.size() / 2)};
+    while (fewest < most) {
+      auto count{fewest + (most - fewest) / 2};
+      text.setString(truncated(count));
+      if (text.getLocalBounds().width > maxWidth) {
+        fewest = count + 1;
       } else {
-        rect.setFillColor(f_highlightedButtonFilledColor);
-        rect.setOutlineColor(f_highlightedButtonOutlineColor);
-        text.setFillColor(f_highlightedButtonTextColor);
+        most = count;
       }
-    } else {
+    }
+    text.setString(truncated(fewest));
+  }
+  text.setPosition(
+      position.x + (textBox.width - text.getLocalBounds().width) * .5f,
+      position.y + f_textBoxTextVerticalPosition);
+  if (textBox.style == TextBoxStyle::Display) {
+    rect.setPosition(position.x + f_displayOutlineThickness,
+                     position.y + f_displayOutlineThickness);
+    rect.setSize({textBox.width - 2 * f_displayOutlineThickness,
+                  f_textBoxHeight - 2 * f_displayOutlineThickness});
+    rect.setOutlineThickness(f_displayOutlineThickness);
+  }
+  applyTextBoxColors(textBox);
+}
+
+void View::applyTextBoxColors(TextBox &textBox) {
+  auto &rect{textBox.rect};
+  auto &text{textBox.text};
+  switch (textBox.style) {
+  case TextBoxStyle::Button:
+    switch (textBox.state) {
+    case TextBoxState::Clicked:
+      rect.setFillColor(f_clickedButtonFillColor);
+      rect.setOutlineColor(f_clickedButtonOutlineColor);
+      text.setFillColor(f_clickedButtonTextColor);
+      break;
+    case TextBoxState::Highlighted:
+      rect.setFillColor(f_highlightedButtonFilledColor);
+      rect.setOutlineColor(f_highlightedButtonOutlineColor);
+      text.setFillColor(f_highlightedButtonTextColor);
+      break;
+    case TextBoxState::Normal:
+    default:
       rect.setFillColor(f_buttonFillColor);
       rect.setOutlineColor(f_buttonOutlineColor);
       text.setFillColor(f_buttonTextColor);
+      break;
     }
     break;
   case TextBoxStyle::Display:
-    rect.setPosition(position.x + f_displayOutlineThickness,
-                     position.y + f_displayOutlineThickness);
-    rect.setSize({width - 2 * f_displayOutlineThickness,
-                  f_textBoxHeight - 2 * f_displayOutlineThickness});
-    rect.setOutlineThickness(f_displayOutlineThickness);
     rect.setFillColor(f_displayTextBoxFillColor);
     rect.setOutlineColor(f_displayTextBoxOutlineColor);
     text.setFillColor(f_displayTextBoxTextFillColor);
@@ -522,19 +848,18 @@ bool View::drawTextBox(const std::string &content, const sf::Vector2f &position,
     text.setFillColor(f_simpleTextBoxTextColor);
     break;
   }
-  m_window.draw(rect);
-  m_window.draw(text);
-  return highlighted;
 }
 
 void View::applyViewOffset(const sf::Vector2f &position) {
+  m_isLayoutChanged = true;
   auto cellSize{calculateCellSize()};
   sf::Vector2f minOffset{static_cast<float>(f_defaultScreenWidth) -
-                             cellSize.x * static_cast<float>(m_model.width()) -
+                             cellSize.x *
+                                 static_cast<float>(m_simulation.width()) -
                              f_frameVerticalThickness,
                          static_cast<float>(f_defaultScreenHeight) -
                              cellSize.y *
-                                 (static_cast<float>(m_model.height()) -
+                                 (static_cast<float>(m_simulation.height()) -
                                   f_frameHorizontalThickness)};
   m_topLeftCellPos.x = std::min(static_cast<float>(f_frameVerticalThickness),
                                 std::max(position.x, minOffset.x));
@@ -567,11 +892,35 @@ sf::Vector2f View::calculateCellSize() const {
   return {static_cast<float>(m_zoomLevel) *
               (static_cast<float>(f_defaultScreenWidth) -
                2 * f_frameVerticalThickness) /
-              static_cast<float>(m_model.width()),
+              static_cast<float>(m_simulation.width()),
           static_cast<float>(m_zoomLevel) *
               (static_cast<float>(f_defaultScreenHeight) -
                f_frameHorizontalThickness) /
-              static_cast<float>(m_model.height())};
+              static_cast<float>(m_simulation.height())};
+}
+
+// The area under the top menu is left out, as the menu is drawn over it.
+View::CellRange View::calculateVisibleCells() const {
+  auto cellSize{calculateCellSize()};
+  auto width{m_simulation.width()};
+  auto height{m_simulation.height()};
+  auto toIndex{[](float cells, std::size_t count) {
+    return static_cast<std::size_t>(
+        std::clamp(cells, 0.f, static_cast<float>(count)));
+  }};
+  return {toIndex(std::floor((f_frameVerticalThickness - m_topLeftCellPos.x) /
+                             cellSize.x),
+                  width),
+          toIndex(std::ceil((f_defaultScreenWidth - f_frameVerticalThickness -
+                             m_topLeftCellPos.x) /
+                            cellSize.x),
+                  width),
+          toIndex(std::floor((f_frameHorizontalThickness - m_topLeftCellPos.y) /
+                             cellSize.y),
+                  height),
+          toIndex(std::ceil((f_defaultScreenHeight - m_topLeftCellPos.y) /
+                            cellSize.y),
+                  height)};
 }
 
 sf::Vector2f View::calculateCellPosition(std::size_t row,
@@ -589,7 +938,7 @@ std::optional<Cell> View::cellAtCoord(sf::Vector2f coord) const {
     return {};
   }
   auto cellSize{calculateCellSize()};
-  return m_model.cellAt(
+  return m_simulation.frame().cellAt(
       static_cast<std::size_t>((coord.x - m_topLeftCellPos.x) / cellSize.x),
       static_cast<std::size_t>((coord.y - m_topLeftCellPos.y) / cellSize.y));
 }
@@ -2,11 +2,18 @@
 #define GAME_OF_LIFE_VIEW_HPP
 
 #include <SFML/Graphics/RenderWindow.hpp>
+#include <SFML/Graphics/Sprite.hpp>
 #include <SFML/Graphics/Text.hpp>
+#include <SFML/Graphics/Texture.hpp>
 #include <SFML/System/Vector2.hpp>
 #include <optional>
+#include <vector>
 
-#include "Model.hpp"
+#include "Cell.hpp"
+#include "Grid.hpp"
+#include "PatternIndex.hpp"
+#include "PatternLoader.hpp"
+#include "Simulation.hpp"
 
 class View {
 public:
@@ -35,7 +42,8 @@ public:
 
   enum class Edit { BirthRule, SurvivalRule, None };
 
-  View(sf::RenderWindow &window, Model &model);
+  View(sf::RenderWindow &window, Simulation &simulation,
+       const PatternLoader &patternLoader);
 
   Screen screen() const;
   Button highlightedButton() const;
@@ -59,6 +67,29 @@ public:
 private:
   enum class TextBoxStyle { Text, Display, Button, HiddenText, HiddenButton };
 
+  enum class TextBoxState { Normal, Highlighted, Clicked };
+
+  // A text box as last drawn. Its shapes are kept between frames and only
+  // laid out again when its content, place or style changes.
+  struct TextBox {
+    std::string content;
+    sf::Vector2f position;
+    float width;
+    TextBoxStyle style;
+    TextBoxState state;
+    sf::RectangleShape rect;
+    sf::Text text;
+  };
+
+  // Columns and rows of the cells at least partly inside the window, with the
+  // last ones excluded.
+  struct CellRange {
+    std::size_t firstCol;
+    std::size_t lastCol;
+    std::size_t firstRow;
+    std::size_t lastRow;
+  };
+
   void drawMainScreen();
   void drawLoadFileScreen();
   void drawSaveFileScreen();
@@ -67,23 +98,52 @@ private:
   void drawBackground();
   void drawGrid();
   void drawCells_();
+  void drawCellTexture(const CellRange &range);
+  void drawCellQuads(const CellRange &range);
+  void updateCellTexture(const CellRange &range);
+  void copyDrawnCells(const CellRange &range);
   void drawTopMenu();
+  void drawProfilerOverlay();
   bool drawTextBox(const std::string &content, const sf::Vector2f &position,
                    float width, TextBoxStyle style);
+  void layOutTextBox(TextBox &textBox);
+  void applyTextBoxColors(TextBox &textBox);
   void applyViewOffset(const sf::Vector2f &offset);
   void applyZoomLevel(int zoomLevel);
   void updateWindowView();
 
   sf::Vector2f calculateCellSize() const;
+  CellRange calculateVisibleCells() const;
+  template <typename Visitor>
+  void forEachChangedCell(const CellRange &range, Visitor visit);
   sf::Vector2f calculateCellPosition(std::size_t row, std::size_t column) const;
   std::optional<Cell> cellAtCoord(sf::Vector2f coord) const;
 
-  Model &m_model;
+  Simulation &m_simulation;
+  const PatternLoader &m_patternLoader;
+  PatternIndex m_patternIndex;
   View::Screen m_screen;
   sf::RenderWindow &m_window;
   sf::Vector2f m_topLeftCellPos;
   sf::VertexArray m_cellsVertexArray;
+  // One pixel per cell, scaled up on draw. Left empty when the grid does not
+  // fit in a texture, and the cells are drawn as quads instead.
+  sf::Texture m_cellsTexture;
+  sf::Sprite m_cellsSprite;
+  std::vector<sf::Uint8> m_cellsPixels;
+  bool m_isCellsTextureCreated;
+  // Cells as last drawn, so the next frame only rewrites the ones that
+  // changed.
+  Grid m_drawnCells;
+  Grid m_drawnVisitedCells;
+  sf::VertexArray m_gridVertexArray;
+  // Set when the view is moved or zoomed, so that cell positions and grid
+  // lines are laid out again.
+  bool m_isLayoutChanged;
   sf::Font m_font;
+  // Text boxes in the order they are drawn within a frame.
+  std::vector<TextBox> m_textBoxes;
+  std::size_t m_textBoxCount;
   Button m_highlightedButton;
   Edit m_highlightedEdit;
   std::optional<std::string> m_highlightedLoadFileMenuItem;